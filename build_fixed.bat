@@ -49,9 +49,27 @@ if %errorlevel% neq 0 goto error
 gcc -std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -O2 -D_CRT_SECURE_NO_WARNINGS -c src\cli.c -o cli.o
 if %errorlevel% neq 0 goto error
 
+gcc -std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -O2 -D_CRT_SECURE_NO_WARNINGS -c src\stream.c -o stream.o
+if %errorlevel% neq 0 goto error
+
+gcc -std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -O2 -D_CRT_SECURE_NO_WARNINGS -c src\parallel.c -o parallel.o
+if %errorlevel% neq 0 goto error
+
+gcc -std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -O2 -D_CRT_SECURE_NO_WARNINGS -c src\integral.c -o integral.o
+if %errorlevel% neq 0 goto error
+
+gcc -std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -O2 -D_CRT_SECURE_NO_WARNINGS -c src\registry.c -o registry.o
+if %errorlevel% neq 0 goto error
+
+gcc -std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -O2 -D_CRT_SECURE_NO_WARNINGS -c src\optimizer.c -o optimizer.o
+if %errorlevel% neq 0 goto error
+
+gcc -std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -O2 -D_CRT_SECURE_NO_WARNINGS -c src\profile.c -o profile.o
+if %errorlevel% neq 0 goto error
+
 echo.
 echo 🔗 Линковка...
-gcc main.o image.o bmp.o filters.o pipeline.o cli.o -o image_craft.exe -lm
+gcc main.o image.o bmp.o filters.o pipeline.o cli.o stream.o parallel.o integral.o registry.o optimizer.o profile.o -o image_craft.exe -lm
 if %errorlevel% neq 0 goto error
 
 REM Очистка временных файлов
@@ -1,7 +1,7 @@
 @echo off
 echo Быстрая компиляция ImageCraft...
 gcc -std=c11 -Wall -Wextra -O2 -D_CRT_SECURE_NO_WARNINGS ^
-    src\main.c src\image.c src\bmp.c src\filters.c src\pipeline.c src\cli.c ^
+    src\main.c src\image.c src\bmp.c src\filters.c src\pipeline.c src\cli.c src\stream.c src\parallel.c src\integral.c src\registry.c src\optimizer.c src\profile.c ^
     -o image_craft.exe -lm
 
 if %errorlevel% equ 0 (
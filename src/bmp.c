@@ -1,10 +1,384 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "bmp.h"
+#include "simd.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Объем буфера для пакетного чтения и записи пикселей
+#define BMP_IO_CHUNK (4 * 1024 * 1024)
+
+// Строка 8-битного изображения
+static inline Color8* image_row_u8(const Image* image, int y) {
+    return (Color8*)image->data + (size_t)image->stride * y;
+}
 
-Image* bmp_read(const char* filename) {
+#ifdef SIMD_X86
+// Обмен первого и третьего байтов пикселей (BGR <-> RGB) одной инструкцией
+// pshufb на 5 пикселей. Загружается и записывается 16 байт: последний байт
+// принадлежит шестому пикселю и перезаписывается следующей итерацией или
+// обычным циклом, поэтому в строке должно быть не меньше 6 пикселей от x.
+// Возвращает число обработанных пикселей.
+SIMD_TARGET("ssse3")
+static int bmp_swap_rb_ssse3(uint8_t* restrict dst, const uint8_t* restrict src, int width) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    int x = 0;
+
+    for (; x + 6 <= width; x += 5) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(src + (size_t)x * 3));
+        _mm_storeu_si128((__m128i*)(dst + (size_t)x * 3), _mm_shuffle_epi8(pixels, shuffle));
+    }
+
+    return x;
+}
+#endif
+
+// Преобразование строки BMP (BGR) в пиксели Color8 (RGB): перестановкой
+// байтов SSSE3, если процессор ее поддерживает, остаток - по пикселю
+static void bmp_decode_row(Color8* restrict dst, const uint8_t* restrict src, int width) {
+    int x = 0;
+
+#ifdef SIMD_X86
+    if (simd_has_ssse3()) {
+        x = bmp_swap_rb_ssse3((uint8_t*)dst, src, width);
+    }
+#endif
+
+    for (; x < width; x++) {
+        const uint8_t* p = src + (size_t)x * 3;
+        dst[x].r = p[2];
+        dst[x].g = p[1];
+        dst[x].b = p[0];
+    }
+}
+
+// Байт на строку в файле, с выравниванием до 4 байт
+static inline size_t bmp_row_size(int width, int bits_per_pixel) {
+    return ((size_t)width * bits_per_pixel + 31) / 32 * 4;
+}
+
+// Байт пикселей строки в файле, без выравнивания
+static inline size_t bmp_row_bytes(int width, int bits_per_pixel) {
+    return ((size_t)width * bits_per_pixel + 7) / 8;
+}
+
+// Декодирование столбцов [x, x + width) строки файла row в пиксели Color8
+static void bmp_decode_pixels(Color8* restrict dst, const uint8_t* restrict row, int x, int width,
+                              const BMPPixelFormat* format) {
+    if (format->bits_per_pixel == 24) {
+        bmp_decode_row(dst, row + (size_t)x * 3, width);
+        return;
+    }
+
+    for (int i = 0; i < width; i++) {
+        int p = x + i;
+        dst[i] = format->palette[(row[p / 8] >> (7 - p % 8)) & 1];
+    }
+}
+
+// Палитра 1-битного файла: два элемента BGRA
+static void bmp_parse_palette(BMPPixelFormat* format, const uint8_t entries[8]) {
+    for (int i = 0; i < 2; i++) {
+        format->palette[i].r = entries[4 * i + 2];
+        format->palette[i].g = entries[4 * i + 1];
+        format->palette[i].b = entries[4 * i];
+    }
+}
+
+// Перевод значения [0, 1] в 0-255 с ограничением и округлением до ближайшего
+static inline uint8_t pack_channel(float value) {
+    return (uint8_t)(clamp01(value) * 255.0f + 0.5f);
+}
+
+// Перевод 16-битного значения в 0-255: v * 255 / 65535 = v / 257, до ближайшего
+static inline uint8_t pack_channel16(uint16_t value) {
+    return (uint8_t)((value + 128u) / 257u);
+}
+
+#ifdef SIMD_X86
+// Перестановки 48 байт (16 пикселей) из трех регистров в три: байт t
+// регистра j результата берется из регистра i маской [j][i] (-1 - ноль).
+// RGB по порядку в BGR:
+static const int8_t bmp_rgb_to_bgr[3][3][16] = {
+    {
+        { 2,  1,  0,  5,  4,  3,  8,  7,  6, 11, 10,  9, 14, 13, 12, -1},
+        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1},
+        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
+    },
+    {
+        {-1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+        { 0, -1,  4,  3,  2,  7,  6,  5, 10,  9,  8, 13, 12, 11, -1, 15},
+        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0, -1}
+    },
+    {
+        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+        {14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+        {-1,  3,  2,  1,  6,  5,  4,  9,  8,  7, 12, 11, 10, 15, 14, 13}
+    }
+};
+
+// Плоскости B, G, R по 16 байт в BGR
+static const int8_t bmp_planes_to_bgr[3][3][16] = {
+    {
+        { 0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1,  5},
+        {-1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1},
+        {-1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1}
+    },
+    {
+        {-1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10, -1},
+        { 5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10},
+        {-1,  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1}
+    },
+    {
+        {-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1},
+        {-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1},
+        {10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15}
+    }
+};
+
+// Запись 48 байт in, переставленных по masks, в dst
+SIMD_TARGET("ssse3")
+static inline void bmp_store_shuffled(uint8_t* dst, const __m128i in[3], const int8_t masks[3][3][16]) {
+    for (int j = 0; j < 3; j++) {
+        __m128i out = _mm_setzero_si128();
+        for (int i = 0; i < 3; i++) {
+            __m128i mask = _mm_loadu_si128((const __m128i*)masks[j][i]);
+            out = _mm_or_si128(out, _mm_shuffle_epi8(in[i], mask));
+        }
+        _mm_storeu_si128((__m128i*)(dst + 16 * j), out);
+    }
+}
+
+// 16 значений float -> 16 байт, как pack_channel: ограничение [0, 1],
+// умножение на 255, прибавление 0.5 и отбрасывание дробной части
+SIMD_TARGET("ssse3")
+static inline __m128i bmp_pack_float16(const float* src) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i values[4];
+
+    for (int i = 0; i < 4; i++) {
+        __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + 4 * i), zero), one);
+        values[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+    }
+
+    return _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]),
+                            _mm_packs_epi32(values[2], values[3]));
+}
+
+// 16 значений uint16 -> 16 байт, как pack_channel16: (v + 128) / 257 =
+// (n - n / 256) / 256 для n = v + 128 (точно при n < 65664), в 32-битных элементах
+SIMD_TARGET("ssse3")
+static inline __m128i bmp_pack_u16x16(const uint16_t* src) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(128);
+    __m128i values[4];
+
+    for (int i = 0; i < 2; i++) {
+        __m128i words = _mm_loadu_si128((const __m128i*)(src + 8 * i));
+        __m128i halves[2] = {_mm_unpacklo_epi16(words, zero), _mm_unpackhi_epi16(words, zero)};
+
+        for (int k = 0; k < 2; k++) {
+            __m128i n = _mm_add_epi32(halves[k], round);
+            values[2 * i + k] = _mm_srli_epi32(_mm_sub_epi32(n, _mm_srli_epi32(n, 8)), 8);
+        }
+    }
+
+    return _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]),
+                            _mm_packs_epi32(values[2], values[3]));
+}
+
+// Упаковка строк по 16 пикселей; возвращают число обработанных пикселей
+
+SIMD_TARGET("ssse3")
+static int bmp_encode_u16_ssse3(uint8_t* dst, const Color16* src, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint16_t* values = (const uint16_t*)(src + x);
+        __m128i rgb[3] = {bmp_pack_u16x16(values), bmp_pack_u16x16(values + 16),
+                          bmp_pack_u16x16(values + 32)};
+        bmp_store_shuffled(dst + (size_t)x * 3, rgb, bmp_rgb_to_bgr);
+    }
+    return x;
+}
+
+SIMD_TARGET("ssse3")
+static int bmp_encode_float_ssse3(uint8_t* dst, const Color* src, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const float* values = (const float*)(src + x);
+        __m128i rgb[3] = {bmp_pack_float16(values), bmp_pack_float16(values + 16),
+                          bmp_pack_float16(values + 32)};
+        bmp_store_shuffled(dst + (size_t)x * 3, rgb, bmp_rgb_to_bgr);
+    }
+    return x;
+}
+
+SIMD_TARGET("ssse3")
+static int bmp_encode_planar_ssse3(uint8_t* dst, const float* r, const float* g, const float* b,
+                                   int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i planes[3] = {bmp_pack_float16(b + x), bmp_pack_float16(g + x),
+                             bmp_pack_float16(r + x)};
+        bmp_store_shuffled(dst + (size_t)x * 3, planes, bmp_planes_to_bgr);
+    }
+    return x;
+}
+#endif
+
+// Упаковка строки изображения в BMP (BGR8) для каждого формата хранения.
+// Основная часть строки упаковывается ядрами SSSE3, если процессор их
+// поддерживает, с тем же результатом; остаток - по пикселю.
+static void bmp_encode_row(uint8_t* restrict dst, const Image* image, int y) {
+    int width = image->width;
+    int x = 0;
+
+#ifdef SIMD_X86
+    bool ssse3 = simd_has_ssse3();
+#endif
+
+    switch (image->format) {
+        case PIXEL_FORMAT_U8: {
+            // 8-битные данные записываются без преобразований
+            const Color8* src = image_row_u8(image, y);
+#ifdef SIMD_X86
+            if (ssse3) {
+                x = bmp_swap_rb_ssse3(dst, (const uint8_t*)src, width);
+            }
+#endif
+            for (; x < width; x++) {
+                uint8_t* p = dst + (size_t)x * 3;
+                p[0] = src[x].b;
+                p[1] = src[x].g;
+                p[2] = src[x].r;
+            }
+            break;
+        }
+        case PIXEL_FORMAT_U16: {
+            const Color16* src = (const Color16*)image->data + (size_t)image->stride * y;
+#ifdef SIMD_X86
+            if (ssse3) {
+                x = bmp_encode_u16_ssse3(dst, src, width);
+            }
+#endif
+            for (; x < width; x++) {
+                uint8_t* p = dst + (size_t)x * 3;
+                p[0] = pack_channel16(src[x].b);
+                p[1] = pack_channel16(src[x].g);
+                p[2] = pack_channel16(src[x].r);
+            }
+            break;
+        }
+        case PIXEL_FORMAT_FLOAT: {
+            const Color* src = (const Color*)image->data + (size_t)image->stride * y;
+#ifdef SIMD_X86
+            if (ssse3) {
+                x = bmp_encode_float_ssse3(dst, src, width);
+            }
+#endif
+            for (; x < width; x++) {
+                uint8_t* p = dst + (size_t)x * 3;
+                p[0] = pack_channel(src[x].b);
+                p[1] = pack_channel(src[x].g);
+                p[2] = pack_channel(src[x].r);
+            }
+            break;
+        }
+        case PIXEL_FORMAT_PLANAR: {
+            const float* r = image_plane_row(image, 0, y);
+            const float* g = image_plane_row(image, 1, y);
+            const float* b = image_plane_row(image, 2, y);
+#ifdef SIMD_X86
+            if (ssse3) {
+                x = bmp_encode_planar_ssse3(dst, r, g, b, width);
+            }
+#endif
+            for (; x < width; x++) {
+                uint8_t* p = dst + (size_t)x * 3;
+                p[0] = pack_channel(b[x]);
+                p[1] = pack_channel(g[x]);
+                p[2] = pack_channel(r[x]);
+            }
+            break;
+        }
+        case PIXEL_FORMAT_MASK: {
+            const uint8_t* bits = image_mask_row(image, y);
+            for (; x < width; x++) {
+                uint8_t* p = dst + (size_t)x * 3;
+                p[0] = p[1] = p[2] = (bits[x / 8] >> (7 - x % 8)) & 1 ? 255 : 0;
+            }
+            break;
+        }
+    }
+}
+
+// Переход к смещению в файле без ограничения long 32 битами
+static bool seek_file(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Проверка формата (24-битные и 1-битные с палитрой, без сжатия) и размеров
+static bool bmp_check_info_header(const BMPInfoHeader* info_header, const char* filename) {
+    if (info_header->bits_per_pixel != 24 && info_header->bits_per_pixel != 1) {
+        fprintf(stderr, "Error: Only 24-bit and 1-bit BMP supported (got %d-bit) in '%s'\n",
+                info_header->bits_per_pixel, filename);
+        return false;
+    }
+
+    if (info_header->bits_per_pixel == 1 && info_header->colors_used > 2) {
+        fprintf(stderr, "Error: Invalid palette of %u colors for 1-bit BMP '%s'\n",
+                (unsigned)info_header->colors_used, filename);
+        return false;
+    }
+
+    if (info_header->compression != 0) {
+        fprintf(stderr, "Error: Only uncompressed BMP supported in '%s'\n", filename);
+        return false;
+    }
+
+    if (info_header->width <= 0 || info_header->height == 0 || info_header->height == INT32_MIN) {
+        fprintf(stderr, "Error: Invalid image dimensions %dx%d in '%s'\n",
+                (int)info_header->width, (int)info_header->height, filename);
+        return false;
+    }
+
+    return true;
+}
+
+// Ограничение области размерами изображения; false, если область пуста
+static bool bmp_clip_region(int image_width, int image_height,
+                            int* x, int* y, int* width, int* height) {
+    if (*x < 0 || *y < 0 || *x >= image_width || *y >= image_height) {
+        return false;
+    }
+
+    if (*width > image_width - *x) *width = image_width - *x;
+    if (*height > image_height - *y) *height = image_height - *y;
+    return *width > 0 && *height > 0;
+}
+
+Image* bmp_read_region(const char* filename, int x, int y, int width, int height) {
     if (!filename) {
         fprintf(stderr, "Error: Filename is NULL\n");
         return NULL;
@@ -39,39 +413,38 @@ Image* bmp_read(const char* filename) {
         return NULL;
     }
 
-    // Проверка формата (только 24-битные без сжатия)
-    if (info_header.bits_per_pixel != 24) {
-        fprintf(stderr, "Error: Only 24-bit BMP supported (got %d-bit) in '%s'\n",
-                info_header.bits_per_pixel, filename);
+    if (!bmp_check_info_header(&info_header, filename)) {
         fclose(file);
         return NULL;
     }
 
-    if (info_header.compression != 0) {
-        fprintf(stderr, "Error: Only uncompressed BMP supported in '%s'\n", filename);
-        fclose(file);
-        return NULL;
-    }
-
-    // Переход к данным изображения
-    if (fseek(file, file_header.data_offset, SEEK_SET) != 0) {
-        fprintf(stderr, "Error: Cannot seek to pixel data in '%s'\n", filename);
-        fclose(file);
-        return NULL;
+    // Палитра 1-битного файла следует за заголовком информации
+    BMPPixelFormat format = {0};
+    format.bits_per_pixel = info_header.bits_per_pixel;
+    if (format.bits_per_pixel == 1) {
+        uint8_t entries[8];
+        if (!seek_file(file, sizeof(BMPFileHeader) + (uint64_t)info_header.header_size) ||
+            fread(entries, 1, sizeof(entries), file) != sizeof(entries)) {
+            fprintf(stderr, "Error: Cannot read BMP palette from '%s'\n", filename);
+            fclose(file);
+            return NULL;
+        }
+        bmp_parse_palette(&format, entries);
     }
 
-    // Создание изображения
-    int width = info_header.width;
-    int height = abs(info_header.height); // Обрабатываем отрицательную высоту
+    int image_width = info_header.width;
+    int image_height = abs(info_header.height); // Обрабатываем отрицательную высоту
 
-    if (width <= 0 || height <= 0) {
-        fprintf(stderr, "Error: Invalid image dimensions %dx%d in '%s'\n",
-                width, height, filename);
+    // Область ограничивается размерами изображения так же, как в image_view
+    if (!bmp_clip_region(image_width, image_height, &x, &y, &width, &height)) {
+        fprintf(stderr, "Error: Region %dx%d at (%d, %d) is outside the %dx%d image '%s'\n",
+                width, height, x, y, image_width, image_height, filename);
         fclose(file);
         return NULL;
     }
 
-    Image* image = image_create(width, height);
+    // Данные BMP 8-битные, поэтому храним их без перехода к float
+    Image* image = image_create_format(width, height, PIXEL_FORMAT_U8);
     if (!image) {
         fprintf(stderr, "Error: Cannot create image structure for '%s'\n", filename);
         fclose(file);
@@ -79,53 +452,307 @@ Image* bmp_read(const char* filename) {
     }
 
     // Расчет выравнивания строк
-    int row_padding = (4 - (width * 3) % 4) % 4;
+    size_t row_size = bmp_row_size(image_width, format.bits_per_pixel);
+    size_t row_padding = row_size - bmp_row_bytes(image_width, format.bits_per_pixel);
 
-    // Определяем порядок строк (снизу вверх или сверху вниз)
+    // Определяем порядок строк (снизу вверх или сверху вниз).
+    // Строки области занимают в файле непрерывный диапазон [file_first, file_first + height)
     int is_top_down = info_header.height < 0;
+    int file_first = is_top_down ? y : image_height - y - height;
+
+    // Узкая область читается по строкам только нужными столбцами,
+    // широкая - пачками целых строк объемом около BMP_IO_CHUNK байт.
+    // Строки 1-битного файла короткие и всегда читаются целиком.
+    size_t region_bytes = (size_t)width * 3;
+    bool narrow = format.bits_per_pixel == 24 && region_bytes * 2 < row_size;
+
+    int batch_rows = narrow ? 1 : (int)(BMP_IO_CHUNK / row_size);
+    if (batch_rows < 1) batch_rows = 1;
+    if (batch_rows > height) batch_rows = height;
+
+    uint8_t* batch = (uint8_t*)malloc(narrow ? region_bytes : row_size * batch_rows);
+    if (!batch) {
+        fprintf(stderr, "Error: Memory allocation failed for BMP read buffer\n");
+        image_destroy(image);
+        fclose(file);
+        return NULL;
+    }
 
-    // Чтение данных пикселей
-    for (int y = 0; y < height; y++) {
-        int target_y = is_top_down ? y : (height - 1 - y);
-
-        for (int x = 0; x < width; x++) {
-            uint8_t pixel[3];
-            if (fread(pixel, 3, 1, file) != 1) {
-                fprintf(stderr, "Error: Cannot read pixel data at (%d, %d) in '%s'\n",
-                        x, y, filename);
-                image_destroy(image);
-                fclose(file);
-                return NULL;
-            }
+    // Переход к данным области
+    uint64_t first_offset = file_header.data_offset + (uint64_t)row_size * file_first;
+    if (!seek_file(file, first_offset + (narrow ? (uint64_t)x * 3 : 0))) {
+        fprintf(stderr, "Error: Cannot seek to pixel data in '%s'\n", filename);
+        free(batch);
+        image_destroy(image);
+        fclose(file);
+        return NULL;
+    }
 
-            // BMP хранит цвета в порядке BGR
-            Color color = color_create(
-                pixel[2] / 255.0f, // R
-                pixel[1] / 255.0f, // G
-                pixel[0] / 255.0f  // B
-            );
+    for (int f = 0; f < height; f += batch_rows) {
+        int rows = height - f < batch_rows ? height - f : batch_rows;
+        size_t bytes;
+        bool ok;
+
+        if (narrow) {
+            bytes = region_bytes;
+            ok = (f == 0 || seek_file(file, first_offset + row_size * f + (uint64_t)x * 3)) &&
+                 fread(batch, 1, bytes, file) == bytes;
+        } else {
+            // Выравнивание после последней строки в файле может отсутствовать
+            bytes = row_size * rows - (file_first + f + rows == image_height ? row_padding : 0);
+            ok = fread(batch, 1, bytes, file) == bytes;
+        }
 
-            image_set_pixel(image, x, target_y, color);
+        if (!ok) {
+            fprintf(stderr, "Error: Cannot read pixel data at row %d in '%s'\n", file_first + f, filename);
+            free(batch);
+            image_destroy(image);
+            fclose(file);
+            return NULL;
         }
 
-        // Пропуск выравнивания
-        if (row_padding > 0) {
-            if (fseek(file, row_padding, SEEK_CUR) != 0) {
-                fprintf(stderr, "Error: Cannot skip padding in '%s'\n", filename);
-                image_destroy(image);
-                fclose(file);
-                return NULL;
+        for (int i = 0; i < rows; i++) {
+            int file_row = file_first + f + i;
+            int target_y = (is_top_down ? file_row : image_height - 1 - file_row) - y;
+            if (narrow) {
+                bmp_decode_row(image_row_u8(image, target_y), batch, width);
+            } else {
+                bmp_decode_pixels(image_row_u8(image, target_y), batch + row_size * i, x, width, &format);
             }
         }
     }
 
+    free(batch);
     fclose(file);
     return image;
 }
 
-bool bmp_write(const char* filename, const Image* image) {
-    if (!filename || !image) {
-        fprintf(stderr, "Error: Invalid parameters for bmp_write\n");
+Image* bmp_read(const char* filename) {
+    return bmp_read_region(filename, 0, 0, INT_MAX, INT_MAX);
+}
+
+// Отображение всего файла в память только для чтения
+static bool map_file(BMPMap* map, const char* filename) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        fprintf(stderr, "Error: Cannot get size of '%s'\n", filename);
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        fprintf(stderr, "Error: Cannot map file '%s'\n", filename);
+        return false;
+    }
+
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!base) {
+        fprintf(stderr, "Error: Cannot map file '%s'\n", filename);
+        CloseHandle(mapping);
+        return false;
+    }
+
+    map->map_base = base;
+    map->map_size = (size_t)size.QuadPart;
+    map->handle = mapping;
+    return true;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file '%s': %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        fprintf(stderr, "Error: Cannot get size of '%s'\n", filename);
+        close(fd);
+        return false;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map file '%s': %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    // Строки обычно читаются подряд, ядро может читать страницы заранее
+    posix_madvise(base, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    map->map_base = base;
+    map->map_size = (size_t)st.st_size;
+    map->handle = NULL;
+    return true;
+#endif
+}
+
+bool bmp_map_open(BMPMap* map, const char* filename) {
+    if (!map || !filename) {
+        fprintf(stderr, "Error: Invalid parameters for bmp_map_open\n");
+        return false;
+    }
+
+    memset(map, 0, sizeof(BMPMap));
+    if (!map_file(map, filename)) {
+        return false;
+    }
+
+    const uint8_t* data = (const uint8_t*)map->map_base;
+    BMPFileHeader file_header;
+    BMPInfoHeader info_header;
+
+    if (map->map_size < sizeof(BMPFileHeader) + sizeof(BMPInfoHeader)) {
+        fprintf(stderr, "Error: Cannot read BMP headers from '%s'\n", filename);
+        bmp_map_close(map);
+        return false;
+    }
+
+    memcpy(&file_header, data, sizeof(BMPFileHeader));
+    memcpy(&info_header, data + sizeof(BMPFileHeader), sizeof(BMPInfoHeader));
+
+    if (file_header.signature != 0x4D42) { // 'BM'
+        fprintf(stderr, "Error: Invalid BMP signature in '%s' (expected 'BM')\n", filename);
+        bmp_map_close(map);
+        return false;
+    }
+
+    if (!bmp_check_info_header(&info_header, filename)) {
+        bmp_map_close(map);
+        return false;
+    }
+
+    map->width = info_header.width;
+    map->height = abs(info_header.height);
+    map->top_down = info_header.height < 0;
+    map->format.bits_per_pixel = info_header.bits_per_pixel;
+
+    // Палитра 1-битного файла следует за заголовком информации
+    if (map->format.bits_per_pixel == 1) {
+        size_t palette_offset = sizeof(BMPFileHeader) + (size_t)info_header.header_size;
+        if (palette_offset > map->map_size || map->map_size - palette_offset < 8) {
+            fprintf(stderr, "Error: Cannot read BMP palette from '%s'\n", filename);
+            bmp_map_close(map);
+            return false;
+        }
+        bmp_parse_palette(&map->format, data + palette_offset);
+    }
+
+    map->row_size = bmp_row_size(map->width, map->format.bits_per_pixel);
+    size_t row_padding = map->row_size - bmp_row_bytes(map->width, map->format.bits_per_pixel);
+
+    // Выравнивание после последней строки в файле может отсутствовать
+    size_t data_size = map->row_size * map->height - row_padding;
+    if (file_header.data_offset > map->map_size ||
+        map->map_size - file_header.data_offset < data_size) {
+        fprintf(stderr, "Error: Pixel data in '%s' is truncated\n", filename);
+        bmp_map_close(map);
+        return false;
+    }
+
+    map->pixels = data + file_header.data_offset;
+    return true;
+}
+
+void bmp_map_close(BMPMap* map) {
+    if (!map || !map->map_base) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(map->map_base);
+    CloseHandle((HANDLE)map->handle);
+#else
+    munmap(map->map_base, map->map_size);
+#endif
+
+    memset(map, 0, sizeof(BMPMap));
+}
+
+const uint8_t* bmp_map_row(const BMPMap* map, int y) {
+    int file_row = map->top_down ? y : map->height - 1 - y;
+    return map->pixels + map->row_size * file_row;
+}
+
+bool bmp_map_read_region(const BMPMap* map, Image* image, int x, int y, int width, int rows) {
+    if (!map || !image || image->format != PIXEL_FORMAT_U8 ||
+        image->width < width || image->height < rows ||
+        x < 0 || width < 0 || x + width > map->width ||
+        y < 0 || rows < 0 || y + rows > map->height) {
+        fprintf(stderr, "Error: Invalid parameters for bmp_map_read_region\n");
+        return false;
+    }
+
+    // Затрагиваются только страницы с нужными строками и столбцами
+    for (int i = 0; i < rows; i++) {
+        bmp_decode_pixels(image_row_u8(image, i), bmp_map_row(map, y + i), x, width, &map->format);
+    }
+    return true;
+}
+
+bool bmp_map_read_rows(const BMPMap* map, Image* image, int y, int rows) {
+    return bmp_map_read_region(map, image, 0, y, map ? map->width : 0, rows);
+}
+
+Image* bmp_read_mapped_region(const char* filename, int x, int y, int width, int height) {
+    BMPMap map;
+    if (!bmp_map_open(&map, filename)) {
+        return NULL;
+    }
+
+    if (!bmp_clip_region(map.width, map.height, &x, &y, &width, &height)) {
+        fprintf(stderr, "Error: Region %dx%d at (%d, %d) is outside the %dx%d image '%s'\n",
+                width, height, x, y, map.width, map.height, filename);
+        bmp_map_close(&map);
+        return NULL;
+    }
+
+    Image* image = image_create_format(width, height, PIXEL_FORMAT_U8);
+    if (!image) {
+        fprintf(stderr, "Error: Cannot create image structure for '%s'\n", filename);
+        bmp_map_close(&map);
+        return NULL;
+    }
+
+    // Строки декодируются прямо из отображения, без промежуточного буфера
+    bmp_map_read_region(&map, image, x, y, width, height);
+    bmp_map_close(&map);
+    return image;
+}
+
+Image* bmp_read_mapped(const char* filename) {
+    return bmp_read_mapped_region(filename, 0, 0, INT_MAX, INT_MAX);
+}
+
+bool bmp_writer_open(BMPWriter* writer, const char* filename, int width, int height, bool mask) {
+    if (!writer || !filename || width <= 0 || height <= 0) {
+        fprintf(stderr, "Error: Invalid parameters for bmp_writer_open\n");
+        return false;
+    }
+
+    memset(writer, 0, sizeof(BMPWriter));
+
+    // Расчет выравнивания строк; строки маски выровнены так же, как строки
+    // 1-битного файла, и переносятся без перепаковки
+    int row_padding = (4 - (width * 3) % 4) % 4;
+    size_t row_size = mask ? (size_t)(width + 31) / 32 * 4 : (size_t)width * 3 + row_padding;
+    uint32_t data_offset = mask ? 54 + 2 * 4 : 54;
+    uint64_t image_size = (uint64_t)row_size * height;
+    uint64_t file_size = data_offset + image_size;
+
+    // Размеры в заголовке BMP 32-битные
+    if (file_size > UINT32_MAX) {
+        fprintf(stderr, "Error: Image %dx%d is too large for BMP '%s'\n", width, height, filename);
         return false;
     }
 
@@ -135,35 +762,32 @@ bool bmp_write(const char* filename, const Image* image) {
         return false;
     }
 
-    // Расчет выравнивания строк
-    int row_padding = (4 - (image->width * 3) % 4) % 4;
-    int row_size = image->width * 3 + row_padding;
-    int image_size = row_size * image->height;
-    int file_size = 54 + image_size;
-
     // Заголовок файла
     BMPFileHeader file_header = {
         .signature = 0x4D42, // 'BM'
-        .file_size = file_size,
+        .file_size = (uint32_t)file_size,
         .reserved = 0,
-        .data_offset = 54
+        .data_offset = data_offset
     };
 
     // Информационный заголовок
     BMPInfoHeader info_header = {
         .header_size = 40,
-        .width = image->width,
-        .height = image->height, // Положительное - снизу вверх
+        .width = width,
+        .height = height, // Положительное - снизу вверх
         .planes = 1,
-        .bits_per_pixel = 24,
+        .bits_per_pixel = mask ? 1 : 24,
         .compression = 0,
-        .image_size = image_size,
+        .image_size = (uint32_t)image_size,
         .x_pixels_per_meter = 2835, // 72 DPI
         .y_pixels_per_meter = 2835,
-        .colors_used = 0,
-        .important_colors = 0
+        .colors_used = mask ? 2 : 0,
+        .important_colors = mask ? 2 : 0
     };
 
+    // Палитра маски BGRX: 0 - черный, 1 - белый
+    static const uint8_t palette[8] = {0, 0, 0, 0, 255, 255, 255, 0};
+
     // Запись заголовков
     if (fwrite(&file_header, sizeof(BMPFileHeader), 1, file) != 1) {
         fprintf(stderr, "Error: Cannot write BMP file header to '%s'\n", filename);
@@ -171,45 +795,121 @@ bool bmp_write(const char* filename, const Image* image) {
         return false;
     }
 
-    if (fwrite(&info_header, sizeof(BMPInfoHeader), 1, file) != 1) {
+    if (fwrite(&info_header, sizeof(BMPInfoHeader), 1, file) != 1 ||
+        (mask && fwrite(palette, sizeof(palette), 1, file) != 1)) {
         fprintf(stderr, "Error: Cannot write BMP info header to '%s'\n", filename);
         fclose(file);
         return false;
     }
 
-    // Запись данных пикселей
-    uint8_t padding[4] = {0, 0, 0, 0};
+    // Строки собираются в буфер и записываются пачками около BMP_IO_CHUNK байт
+    int buffer_rows = (int)(BMP_IO_CHUNK / row_size);
+    if (buffer_rows < 1) buffer_rows = 1;
+    if (buffer_rows > height) buffer_rows = height;
+
+    // calloc: байты выравнивания строк остаются нулевыми
+    writer->buffer = (uint8_t*)calloc((size_t)buffer_rows, row_size);
+    if (!writer->buffer) {
+        fprintf(stderr, "Error: Memory allocation failed for BMP write buffer\n");
+        fclose(file);
+        return false;
+    }
+
+    writer->file = file;
+    writer->filename = filename;
+    writer->width = width;
+    writer->height = height;
+    writer->mask = mask;
+    writer->data_offset = data_offset;
+    writer->row_size = row_size;
+    writer->buffer_rows = buffer_rows;
+    return true;
+}
+
+// Строка маски для 1-битного файла: биты за шириной изображения обнуляются
+static void bmp_encode_mask_row(uint8_t* restrict dst, const Image* image, int y) {
+    size_t bytes = (size_t)(image->width + 7) / 8;
+    memcpy(dst, image_mask_row(image, y), bytes);
+    dst[bytes - 1] &= (uint8_t)(0xFF << (bytes * 8 - image->width));
+}
+
+bool bmp_writer_write_rows(BMPWriter* writer, int y, const Image* image, int image_y, int count) {
+    if (!writer || !writer->file || !image || image->width != writer->width ||
+        (writer->mask && image->format != PIXEL_FORMAT_MASK) ||
+        y < 0 || count < 0 || y + count > writer->height ||
+        image_y < 0 || image_y + count > image->height) {
+        fprintf(stderr, "Error: Invalid parameters for bmp_writer_write_rows\n");
+        return false;
+    }
 
-    for (int y = image->height - 1; y >= 0; y--) {
-        for (int x = 0; x < image->width; x++) {
-            Color color = image_get_pixel(image, x, y);
+    // Строки в файле идут снизу вверх: пачка строк [y, y + rows) занимает
+    // непрерывный участок файла в обратном порядке
+    for (int done = 0; done < count; done += writer->buffer_rows) {
+        int rows = count - done < writer->buffer_rows ? count - done : writer->buffer_rows;
+        int last = y + done + rows - 1;
 
-            // Преобразование в BGR и 0-255
-            uint8_t pixel[3] = {
-                (uint8_t)(color.b * 255),
-                (uint8_t)(color.g * 255),
-                (uint8_t)(color.r * 255)
-            };
+        for (int i = 0; i < rows; i++) {
+            uint8_t* dst = writer->buffer + writer->row_size * i;
+            int row = image_y + (last - y) - i;
 
-            if (fwrite(pixel, 3, 1, file) != 1) {
-                fprintf(stderr, "Error: Cannot write pixel data to '%s'\n", filename);
-                fclose(file);
-                return false;
+            if (writer->mask) {
+                bmp_encode_mask_row(dst, image, row);
+            } else {
+                bmp_encode_row(dst, image, row);
             }
         }
 
-        // Запись выравнивания
-        if (row_padding > 0 && fwrite(padding, row_padding, 1, file) != 1) {
-            fprintf(stderr, "Error: Cannot write padding to '%s'\n", filename);
-            fclose(file);
+        uint64_t offset = writer->data_offset + (uint64_t)writer->row_size * (writer->height - 1 - last);
+        if (!seek_file(writer->file, offset) ||
+            fwrite(writer->buffer, writer->row_size, rows, writer->file) != (size_t)rows) {
+            fprintf(stderr, "Error: Cannot write pixel data to '%s'\n", writer->filename);
             return false;
         }
     }
 
-    fclose(file);
     return true;
 }
 
+bool bmp_writer_close(BMPWriter* writer) {
+    if (!writer || !writer->file) {
+        return false;
+    }
+
+    bool success = fclose(writer->file) == 0;
+    if (!success) {
+        fprintf(stderr, "Error: Cannot finish writing '%s': %s\n", writer->filename, strerror(errno));
+    }
+
+    free(writer->buffer);
+    memset(writer, 0, sizeof(BMPWriter));
+    return success;
+}
+
+bool bmp_write(const char* filename, const Image* image) {
+    if (!filename || !image) {
+        fprintf(stderr, "Error: Invalid parameters for bmp_write\n");
+        return false;
+    }
+
+    BMPWriter writer;
+    if (!bmp_writer_open(&writer, filename, image->width, image->height,
+                         image->format == PIXEL_FORMAT_MASK)) {
+        return false;
+    }
+
+    // Запись данных пикселей снизу вверх, пачками по размеру буфера
+    for (int y = image->height; y > 0; y -= writer.buffer_rows) {
+        int rows = y < writer.buffer_rows ? y : writer.buffer_rows;
+
+        if (!bmp_writer_write_rows(&writer, y - rows, image, y - rows, rows)) {
+            bmp_writer_close(&writer);
+            return false;
+        }
+    }
+
+    return bmp_writer_close(&writer);
+}
+
 bool bmp_is_valid_format(const char* filename) {
     if (!filename) {
         return false;
@@ -3,6 +3,7 @@
 
 #include "image.h"
 #include <stdbool.h>
+#include <stdio.h>
 
 #pragma pack(push, 1)
 typedef struct {
@@ -17,7 +18,7 @@ typedef struct {
     int32_t width;
     int32_t height;
     uint16_t planes;         // 1
-    uint16_t bits_per_pixel; // 24
+    uint16_t bits_per_pixel; // 24 или 1 (с палитрой)
     uint32_t compression;    // 0
     uint32_t image_size;
     int32_t x_pixels_per_meter;
@@ -27,12 +28,79 @@ typedef struct {
 } BMPInfoHeader;
 #pragma pack(pop)
 
-// Чтение BMP файла
+// Пиксели файла: 24-битные BGR или 1-битные индексы палитры из двух цветов
+typedef struct {
+    int bits_per_pixel;
+    Color8 palette[2];
+} BMPPixelFormat;
+
+// BMP файл, отображенный в память. Пиксели не копируются заранее:
+// строки декодируются по запросу прямо из страничного кэша.
+typedef struct {
+    int width;
+    int height;
+    BMPPixelFormat format;
+    bool top_down;             // Порядок строк в файле
+    size_t row_size;           // Байт на строку в файле, с выравниванием
+    const uint8_t* pixels;     // Начало данных пикселей (data_offset)
+    void* map_base;
+    size_t map_size;
+    void* handle;              // Дескриптор отображения (Windows)
+} BMPMap;
+
+// Чтение BMP файла: 24-битного или 1-битного с палитрой (такие пишет
+// bmp_write для масок) в изображение U8
 Image* bmp_read(const char* filename);
 
-// Запись BMP файла
+// Чтение BMP файла через отображение в память
+Image* bmp_read_mapped(const char* filename);
+
+// Чтение только области [x, x + width) x [y, y + height) изображения:
+// читаются и декодируются лишь нужные строки и столбцы.
+// Область ограничивается размерами изображения.
+Image* bmp_read_region(const char* filename, int x, int y, int width, int height);
+Image* bmp_read_mapped_region(const char* filename, int x, int y, int width, int height);
+
+// Отображение BMP файла в память и освобождение отображения
+bool bmp_map_open(BMPMap* map, const char* filename);
+void bmp_map_close(BMPMap* map);
+
+// Данные строки y (отсчет сверху) в формате файла
+const uint8_t* bmp_map_row(const BMPMap* map, int y);
+
+// Декодирование строк [y, y + rows) в строки 0..rows-1 изображения формата U8
+// (1-битные файлы - цветами палитры)
+bool bmp_map_read_rows(const BMPMap* map, Image* image, int y, int rows);
+
+// То же для столбцов [x, x + width)
+bool bmp_map_read_region(const BMPMap* map, Image* image, int x, int y, int width, int rows);
+
+// Запись BMP файла: 24-битного, а для маски (PIXEL_FORMAT_MASK) - 1-битного с палитрой
 bool bmp_write(const char* filename, const Image* image);
 
+// Запись BMP файла по частям: строки можно передавать группами в любом порядке
+typedef struct {
+    FILE* file;
+    const char* filename;
+    int width;
+    int height;
+    bool mask;                 // 1-битный файл с палитрой из строк PIXEL_FORMAT_MASK
+    uint32_t data_offset;      // Начало данных пикселей в файле
+    size_t row_size;           // Байт на строку в файле, с выравниванием
+    uint8_t* buffer;           // Буфер упакованных строк
+    int buffer_rows;
+} BMPWriter;
+
+// Создание файла и запись заголовков: 24-битного или, если mask,
+// 1-битного с палитрой (строки передаются в формате PIXEL_FORMAT_MASK)
+bool bmp_writer_open(BMPWriter* writer, const char* filename, int width, int height, bool mask);
+
+// Запись строк image [image_y, image_y + count) как строк файла [y, y + count)
+bool bmp_writer_write_rows(BMPWriter* writer, int y, const Image* image, int image_y, int count);
+
+// Завершение записи
+bool bmp_writer_close(BMPWriter* writer);
+
 // Проверка формата файла
 bool bmp_is_valid_format(const char* filename);
 
@@ -2,7 +2,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdarg.h>
+
+// Сообщение об ошибке разбора; строка принадлежит args и освобождается в cli_free_args
+static void cli_set_error(CLIArgs* args, const char* format, ...) {
+    char buffer[256];
+    va_list list;
+
+    va_start(list, format);
+    vsnprintf(buffer, sizeof(buffer), format, list);
+    va_end(list);
+
+    args->error = 1;
+    free(args->error_message);
+    args->error_message = _strdup(buffer);
+}
 
 CLIArgs* cli_parse_args(int argc, char** argv) {
     CLIArgs* args = (CLIArgs*)calloc(1, sizeof(CLIArgs));
@@ -16,6 +30,8 @@ CLIArgs* cli_parse_args(int argc, char** argv) {
         return NULL;
     }
 
+    args->optimize = OPTIMIZE_EXACT;
+
     // Если нет аргументов - показываем помощь
     if (argc < 2) {
         args->show_help = 1;
@@ -40,159 +56,122 @@ CLIArgs* cli_parse_args(int argc, char** argv) {
         else if (!args->output_file) {
             args->output_file = _strdup(argv[i]);
         }
-        // Фильтры
+        // Фильтры и параметры
         else if (argv[i][0] == '-') {
-            if (strcmp(argv[i], "-crop") == 0) {
-                if (i + 2 >= argc) {
-                    args->error = 1;
-                    args->error_message = "-crop requires width and height";
-                    return args;
-                }
-
-                CropParams* params = (CropParams*)malloc(sizeof(CropParams));
-                if (!params) {
-                    args->error = 1;
-                    args->error_message = "Memory allocation failed";
-                    return args;
-                }
-
-                params->width = atoi(argv[i + 1]);
-                params->height = atoi(argv[i + 2]);
-
-                if (params->width <= 0 || params->height <= 0) {
-                    free(params);
-                    args->error = 1;
-                    args->error_message = "Crop dimensions must be positive";
-                    return args;
+            const FilterDescriptor* filter = filter_registry_find(argv[i]);
+
+            // Фильтр: параметры разбирает его описание из реестра
+            if (filter) {
+                void* params = NULL;
+                int used = 0;
+
+                if (filter->parse) {
+                    const char* error = NULL;
+                    params = filter->parse(argv + i + 1, argc - i - 1, &used, &error);
+                    if (error) {
+                        cli_set_error(args, "%s", error);
+                        return args;
+                    }
                 }
 
-                pipeline_add_filter(args->pipeline, filter_crop, params, "crop");
-                i += 2;
+                pipeline_add_filter(args->pipeline, filter->function, params, filter->name);
+                i += used;
             }
-            else if (strcmp(argv[i], "-gs") == 0) {
-                pipeline_add_filter(args->pipeline, filter_grayscale, NULL, "grayscale");
+            else if (strcmp(argv[i], "-mmap") == 0) {
+                args->use_mmap = 1;
             }
-            else if (strcmp(argv[i], "-neg") == 0) {
-                pipeline_add_filter(args->pipeline, filter_negative, NULL, "negative");
+            else if (strcmp(argv[i], "-stream") == 0) {
+                args->streaming = 1;
             }
-            else if (strcmp(argv[i], "-sharp") == 0) {
-                pipeline_add_filter(args->pipeline, filter_sharpening, NULL, "sharpening");
+            else if (strcmp(argv[i], "-explain") == 0) {
+                args->explain = 1;
             }
-            else if (strcmp(argv[i], "-edge") == 0) {
-                if (i + 1 >= argc) {
-                    args->error = 1;
-                    args->error_message = "-edge requires threshold";
-                    return args;
-                }
+            else if (strcmp(argv[i], "-profile") == 0) {
+                args->profile = 1;
 
-                EdgeParams* params = (EdgeParams*)malloc(sizeof(EdgeParams));
-                if (!params) {
-                    args->error = 1;
-                    args->error_message = "Memory allocation failed";
+                // Необязательный файл отчета JSON
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    free(args->profile_file);
+                    args->profile_file = _strdup(argv[i + 1]);
+                    i += 1;
+                }
+            }
+            else if (strcmp(argv[i], "-optimize") == 0) {
+                if (i + 1 >= argc) {
+                    cli_set_error(args, "-optimize requires level");
                     return args;
                 }
 
-                params->threshold = (float)atof(argv[i + 1]);
-
-                if (params->threshold < 0 || params->threshold > 1) {
-                    free(params);
-                    args->error = 1;
-                    args->error_message = "Edge threshold must be between 0 and 1";
+                const char* level = argv[i + 1];
+                if (strcmp(level, "off") == 0) {
+                    args->optimize = OPTIMIZE_OFF;
+                } else if (strcmp(level, "exact") == 0) {
+                    args->optimize = OPTIMIZE_EXACT;
+                } else if (strcmp(level, "fast") == 0) {
+                    args->optimize = OPTIMIZE_FAST;
+                } else {
+                    cli_set_error(args, "Optimization level must be off, exact or fast");
                     return args;
                 }
 
-                pipeline_add_filter(args->pipeline, filter_edge_detection, params, "edge_detection");
                 i += 1;
             }
-            else if (strcmp(argv[i], "-med") == 0) {
+            else if (strcmp(argv[i], "-threads") == 0) {
                 if (i + 1 >= argc) {
-                    args->error = 1;
-                    args->error_message = "-med requires window size";
-                    return args;
-                }
-
-                MedianParams* params = (MedianParams*)malloc(sizeof(MedianParams));
-                if (!params) {
-                    args->error = 1;
-                    args->error_message = "Memory allocation failed";
+                    cli_set_error(args, "-threads requires thread count");
                     return args;
                 }
 
-                params->window_size = atoi(argv[i + 1]);
+                args->threads = atoi(argv[i + 1]);
 
-                if (params->window_size <= 0 || params->window_size % 2 == 0) {
-                    free(params);
-                    args->error = 1;
-                    args->error_message = "Median window size must be odd and positive";
+                if (args->threads <= 0) {
+                    cli_set_error(args, "Thread count must be positive");
                     return args;
                 }
 
-                pipeline_add_filter(args->pipeline, filter_median, params, "median");
                 i += 1;
             }
-            else if (strcmp(argv[i], "-blur") == 0) {
+            else if (strcmp(argv[i], "-border") == 0) {
                 if (i + 1 >= argc) {
-                    args->error = 1;
-                    args->error_message = "-blur requires sigma";
-                    return args;
-                }
-
-                BlurParams* params = (BlurParams*)malloc(sizeof(BlurParams));
-                if (!params) {
-                    args->error = 1;
-                    args->error_message = "Memory allocation failed";
+                    cli_set_error(args, "-border requires mode");
                     return args;
                 }
 
-                params->sigma = (float)atof(argv[i + 1]);
-
-                if (params->sigma <= 0) {
-                    free(params);
-                    args->error = 1;
-                    args->error_message = "Blur sigma must be positive";
+                const char* mode = argv[i + 1];
+                if (strcmp(mode, "clamp") == 0) {
+                    args->border.mode = BORDER_CLAMP;
+                } else if (strcmp(mode, "mirror") == 0) {
+                    args->border.mode = BORDER_MIRROR;
+                } else if (strcmp(mode, "wrap") == 0) {
+                    args->border.mode = BORDER_WRAP;
+                } else if (strcmp(mode, "constant") == 0) {
+                    args->border.mode = BORDER_CONSTANT;
+                } else {
+                    cli_set_error(args, "Border mode must be clamp, mirror, wrap or constant");
                     return args;
                 }
 
-                pipeline_add_filter(args->pipeline, filter_gaussian_blur, params, "gaussian_blur");
                 i += 1;
-            }
-            else if (strcmp(argv[i], "-sepia") == 0) {
-                pipeline_add_filter(args->pipeline, filter_sepia, NULL, "sepia");
-            }
-            else if (strcmp(argv[i], "-vignette") == 0) {
-                VignetteParams* params = (VignetteParams*)malloc(sizeof(VignetteParams));
-                if (!params) {
-                    args->error = 1;
-                    args->error_message = "Memory allocation failed";
-                    return args;
-                }
 
-                // Значение по умолчанию
-                params->intensity = 0.8f;
+                // Необязательное значение для constant (по умолчанию 0 - черный)
+                if (args->border.mode == BORDER_CONSTANT && i + 1 < argc && argv[i + 1][0] != '-') {
+                    args->border.value = (float)atof(argv[i + 1]);
+
+                    if (args->border.value < 0 || args->border.value > 1) {
+                        cli_set_error(args, "Border value must be between 0 and 1");
+                        return args;
+                    }
 
-                // Проверяем, есть ли параметр интенсивности
-                if (i + 1 < argc && argv[i + 1][0] != '-') {
-                    params->intensity = (float)atof(argv[i + 1]);
                     i += 1;
                 }
-
-                pipeline_add_filter(args->pipeline, filter_vignette, params, "vignette");
             }
             else {
-                args->error = 1;
-                args->error_message = malloc(100);
-                if (args->error_message) {
-                    sprintf(args->error_message, "Unknown filter: %s", argv[i]);
-                }
+                cli_set_error(args, "Unknown filter: %s", argv[i]);
                 return args;
             }
         }
         else {
-            args->error = 1;
-            args->error_message = malloc(100);
-            if (args->error_message) {
-                sprintf(args->error_message, "Unexpected argument: %s", argv[i]);
-            }
+            cli_set_error(args, "Unexpected argument: %s", argv[i]);
             return args;
         }
 
@@ -201,23 +180,20 @@ CLIArgs* cli_parse_args(int argc, char** argv) {
 
     // Проверка обязательных аргументов
     if (!args->input_file || !args->output_file) {
-        args->error = 1;
-        args->error_message = "Input and output files are required";
+        cli_set_error(args, "Input and output files are required");
         return args;
     }
 
     // Проверка расширений файлов
     if (strstr(args->input_file, ".bmp") == NULL &&
         strstr(args->input_file, ".BMP") == NULL) {
-        args->error = 1;
-        args->error_message = "Input file must have .bmp extension";
+        cli_set_error(args, "Input file must have .bmp extension");
         return args;
     }
 
     if (strstr(args->output_file, ".bmp") == NULL &&
         strstr(args->output_file, ".BMP") == NULL) {
-        args->error = 1;
-        args->error_message = "Output file must have .bmp extension";
+        cli_set_error(args, "Output file must have .bmp extension");
         return args;
     }
 
@@ -233,9 +209,50 @@ void cli_free_args(CLIArgs* args) {
     if (args->output_file) free(args->output_file);
     if (args->pipeline) pipeline_destroy(args->pipeline);
     if (args->error_message) free(args->error_message);
+    if (args->profile_file) free(args->profile_file);
     free(args);
 }
 
+// Колонка описаний в справке
+#define CLI_HELP_COLUMN 28
+
+// Ширина строки UTF-8 в символах
+static int cli_text_width(const char* text) {
+    int width = 0;
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        width += (*p & 0xC0) != 0x80;
+    }
+    return width;
+}
+
+// Строки справки фильтра: ключ с параметрами и описание с колонки
+// CLI_HELP_COLUMN (с новой строки, если ключ длиннее)
+static void cli_print_filter_help(const FilterDescriptor* filter) {
+    char usage[128];
+    snprintf(usage, sizeof(usage), "  %s%s%s", filter->option,
+             filter->usage ? " " : "", filter->usage ? filter->usage : "");
+
+    int width = cli_text_width(usage);
+    if (width < CLI_HELP_COLUMN) {
+        printf("%s%*s", usage, CLI_HELP_COLUMN - width, "");
+    } else {
+        printf("%s\n%*s", usage, CLI_HELP_COLUMN, "");
+    }
+
+    for (const char* line = filter->help; *line; ) {
+        const char* end = strchr(line, '\n');
+        int length = end ? (int)(end - line) : (int)strlen(line);
+
+        printf("%.*s\n", length, line);
+        if (!end) {
+            break;
+        }
+
+        line = end + 1;
+        printf("%*s", CLI_HELP_COLUMN, "");
+    }
+}
+
 void cli_print_help(void) {
     printf("\n");
     printf("╔══════════════════════════════════════════════════════════╗\n");
@@ -246,23 +263,44 @@ void cli_print_help(void) {
     printf("  image_craft.exe <input.bmp> <output.bmp> [фильтры...]\n");
     printf("\n");
     printf("Фильтры:\n");
-    printf("  -crop <ширина> <высота>   Обрезать изображение\n");
-    printf("  -gs                       Градации серого\n");
-    printf("  -neg                      Негатив\n");
-    printf("  -sharp                    Повышение резкости\n");
-    printf("  -edge <порог>             Обнаружение границ (0-1)\n");
-    printf("  -med <размер_окна>        Медианный фильтр (нечетный)\n");
-    printf("  -blur <сигма>             Гауссово размытие\n");
-    printf("  -sepia                    Эффект сепии\n");
-    printf("  -vignette [интенсивность] Виньетирование (0-1, по умолчанию 0.8)\n");
+    for (int i = 0; i < filter_registry_count(); i++) {
+        cli_print_filter_help(filter_registry_get(i));
+    }
+    printf("\n");
+    printf("Параметры:\n");
+    printf("  -mmap                     Читать входной файл через отображение в память и\n");
+    printf("                            декодировать строки полосами по мере обработки\n");
+    printf("                            (как -stream; с -canny, -border wrap и -blur с\n");
+    printf("                            sigma от 5 - целиком)\n");
+    printf("  -stream                   Потоковая обработка полосами строк (для огромных\n");
+    printf("                            изображений, память не зависит от высоты;\n");
+    printf("                            с -canny, -border wrap и -blur с sigma от 5 -\n");
+    printf("                            целиком)\n");
+    printf("  -threads <N>              Число потоков (по умолчанию - по числу ядер)\n");
+    printf("  -border <режим> [значение]\n");
+    printf("                            Продолжение за краями для сверток и размытия:\n");
+    printf("                            clamp (по умолчанию), mirror, wrap или constant\n");
+    printf("                            со значением 0-1 (медиана и box - всегда clamp)\n");
+    printf("  -optimize <уровень>       Перестановка и сокращение фильтров: off, exact\n");
+    printf("                            (по умолчанию, результат не меняется) или fast\n");
+    printf("                            (также слияние размытий, результат приближенный)\n");
+    printf("  -explain                  Вывести исходный и выбранный план фильтров\n");
+    printf("  -profile [отчет.json]     Время, процессорное время, Мп/с и память каждого\n");
+    printf("                            этапа: таблица и JSON (в файл или в stdout)\n");
     printf("\n");
     printf("Примеры:\n");
     printf("  image_craft.exe input.bmp output.bmp -gs\n");
     printf("  image_craft.exe input.bmp output.bmp -crop 800 600 -gs -blur 0.5\n");
     printf("  image_craft.exe input.bmp output.bmp -edge 0.1 -neg\n");
+    printf("  image_craft.exe input.bmp output.bmp -canny 0.05 0.15\n");
     printf("  image_craft.exe input.bmp output.bmp -sepia -vignette 0.7\n");
+    printf("  image_craft.exe input.bmp output.bmp -conv 3x3:-2,-1,0,-1,1,1,0,1,2\n");
+    printf("  image_craft.exe input.bmp output.bmp -border mirror -blur 2\n");
+    printf("  image_craft.exe input.bmp output.bmp -blur 1 -blur 2 -crop 64 64 -optimize fast -explain\n");
+    printf("  image_craft.exe input.bmp output.bmp -med 5 -sharp -profile report.json\n");
     printf("\n");
-    printf("Формат изображений: 24-битный BMP без сжатия\n");
+    printf("Формат изображений: 24-битный BMP без сжатия (на входе также 1-битный\n");
+    printf("с палитрой, как у масок -edge, -threshold и -canny)\n");
     printf("\n");
 }
 
@@ -2,12 +2,21 @@
 #define CLI_H
 
 #include "pipeline.h"
+#include "optimizer.h"
 
 // Структура для аргументов командной строки
 typedef struct {
     char* input_file;
     char* output_file;
     FilterPipeline* pipeline;
+    int use_mmap;        // Чтение входного файла через отображение в память
+    int streaming;       // Потоковая обработка полосами строк
+    int threads;         // Число потоков (0 - по числу ядер)
+    Border border;       // Продолжение изображения за краями в фильтрах
+    OptimizeLevel optimize;  // Перезапись цепочки фильтров перед выполнением
+    int explain;         // Вывод выбранного плана фильтров
+    int profile;         // Замеры времени и памяти этапов
+    char* profile_file;  // Файл отчета JSON (NULL - вывод в stdout)
     int show_help;
     int error;
     char* error_message;
@@ -1,9 +1,60 @@
 #include "filters.h"
+#include "simd.h"
+#include "parallel.h"
+#include "integral.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+
+// Наименьшая sigma, с которой размытие выполняется рекурсивным фильтром
+#define BLUR_RECURSIVE_MIN_SIGMA 5.0f
+
+// Число проходов box-фильтра в приближении гауссова размытия
+#define BLUR_BOX_PASSES 3
+
+// Наименьшее окно, с которого медиана 8-битного изображения считается по гистограммам
+#define MEDIAN_HISTOGRAM_MIN_WINDOW 7
+
+// Полос на поток при связывании границ Canny: мелкие полосы выравнивают нагрузку
+#define CANNY_BANDS_PER_THREAD 4
+
+// Вывод сообщений фильтров о ходе работы
+static bool filters_verbose = true;
+
+void filters_set_verbose(bool verbose) {
+    filters_verbose = verbose;
+}
+
+static void filter_log(const char* format, ...) {
+    if (!filters_verbose) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+// Продолжение изображения за краями в свертках и гауссовом размытии
+static Border filters_border = {BORDER_CLAMP, 0.0f};
+
+void filters_set_border(Border border) {
+    filters_border = border;
+}
+
+Border filters_get_border(void) {
+    return filters_border;
+}
+
+// Ограничение индекса строки или столбца диапазоном [0, max]
+static inline int clamp_index(int value, int max) {
+    return value < 0 ? 0 : (value > max ? max : value);
+}
 
 // Crop filter
 void filter_crop(Image* image, void* params) {
@@ -13,42 +64,56 @@ void filter_crop(Image* image, void* params) {
     }
 
     CropParams* crop = (CropParams*)params;
-    int new_width = crop->width;
-    int new_height = crop->height;
-
-    // Ограничение размеров до размеров изображения
-    if (new_width > image->width) new_width = image->width;
-    if (new_height > image->height) new_height = image->height;
 
-    if (new_width <= 0 || new_height <= 0) {
-        fprintf(stderr, "Error: Invalid crop dimensions %dx%d\n", new_width, new_height);
+    if (crop->x < 0 || crop->y < 0 || crop->x >= image->width || crop->y >= image->height) {
+        fprintf(stderr, "Error: Crop offset (%d, %d) is outside the %dx%d image\n",
+                crop->x, crop->y, image->width, image->height);
         return;
     }
 
-    printf("Cropping to %dx%d\n", new_width, new_height);
+    // Область ограничивается размерами изображения
+    ImageView view = image_view(image, crop->x, crop->y, crop->width, crop->height);
 
-    // Создание нового изображения с обрезанными размерами
-    Image* cropped = image_create(new_width, new_height);
-    if (!cropped) {
-        fprintf(stderr, "Error: Cannot create cropped image\n");
+    if (view.width <= 0 || view.height <= 0) {
+        fprintf(stderr, "Error: Invalid crop dimensions %dx%d\n", view.width, view.height);
         return;
     }
 
-    // Копирование верхней левой части
-    for (int y = 0; y < new_height; y++) {
-        for (int x = 0; x < new_width; x++) {
-            Color color = image_get_pixel(image, x, y);
-            image_set_pixel(cropped, x, y, color);
+    filter_log("Cropping to %dx%d at (%d, %d)\n", view.width, view.height, crop->x, crop->y);
+
+    // Изображение становится областью исходного буфера, пиксели не копируются
+    image_apply_view(image, view);
+}
+
+// Строки [y_begin, y_end) фильтра grayscale
+static void grayscale_rows(void* context, int y_begin, int y_end) {
+    Image* image = (Image*)context;
+
+    for (int y = y_begin; y < y_end; y++) {
+        // Целочисленные форматы обрабатываются без перехода к float
+        if (image->format == PIXEL_FORMAT_U8) {
+            Color8* pixels = (Color8*)image->data + (size_t)image->stride * y;
+            for (int x = 0; x < image->width; x++) {
+                Color8 c = pixels[x];
+                uint8_t l = (uint8_t)(0.299f * c.r + 0.587f * c.g + 0.114f * c.b + 0.5f);
+                pixels[x].r = pixels[x].g = pixels[x].b = l;
+            }
+        } else if (image->format == PIXEL_FORMAT_U16) {
+            Color16* pixels = (Color16*)image->data + (size_t)image->stride * y;
+            for (int x = 0; x < image->width; x++) {
+                Color16 c = pixels[x];
+                uint16_t l = (uint16_t)(0.299f * c.r + 0.587f * c.g + 0.114f * c.b + 0.5f);
+                pixels[x].r = pixels[x].g = pixels[x].b = l;
+            }
+        } else {
+            for (int x = 0; x < image->width; x++) {
+                Color color = image_get_pixel(image, x, y);
+                float luminance = color_luminance(color);
+                Color gray = color_create(luminance, luminance, luminance);
+                image_set_pixel(image, x, y, gray);
+            }
         }
     }
-
-    // Замена данных изображения
-    free(image->data);
-    image->data = cropped->data;
-    image->width = cropped->width;
-    image->height = cropped->height;
-    image->capacity = cropped->capacity;
-    free(cropped);
 }
 
 // Grayscale filter
@@ -58,14 +123,40 @@ void filter_grayscale(Image* image, void* params) {
         return;
     }
 
-    printf("Converting to grayscale\n");
+    filter_log("Converting to grayscale\n");
+    parallel_for_rows(image->height, grayscale_rows, image);
+}
 
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            Color color = image_get_pixel(image, x, y);
-            float luminance = color_luminance(color);
-            Color gray = color_create(luminance, luminance, luminance);
-            image_set_pixel(image, x, y, gray);
+// Строки [y_begin, y_end) фильтра negative
+static void negative_rows(void* context, int y_begin, int y_end) {
+    Image* image = (Image*)context;
+
+    for (int y = y_begin; y < y_end; y++) {
+        // Для целочисленных форматов негатив точен: max - v
+        if (image->format == PIXEL_FORMAT_U8) {
+            Color8* pixels = (Color8*)image->data + (size_t)image->stride * y;
+            for (int x = 0; x < image->width; x++) {
+                pixels[x].r = 255 - pixels[x].r;
+                pixels[x].g = 255 - pixels[x].g;
+                pixels[x].b = 255 - pixels[x].b;
+            }
+        } else if (image->format == PIXEL_FORMAT_U16) {
+            Color16* pixels = (Color16*)image->data + (size_t)image->stride * y;
+            for (int x = 0; x < image->width; x++) {
+                pixels[x].r = 65535 - pixels[x].r;
+                pixels[x].g = 65535 - pixels[x].g;
+                pixels[x].b = 65535 - pixels[x].b;
+            }
+        } else {
+            for (int x = 0; x < image->width; x++) {
+                Color color = image_get_pixel(image, x, y);
+                Color negative = color_create(
+                    1.0f - color.r,
+                    1.0f - color.g,
+                    1.0f - color.b
+                );
+                image_set_pixel(image, x, y, negative);
+            }
         }
     }
 }
@@ -77,19 +168,8 @@ void filter_negative(Image* image, void* params) {
         return;
     }
 
-    printf("Applying negative filter\n");
-
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            Color color = image_get_pixel(image, x, y);
-            Color negative = color_create(
-                1.0f - color.r,
-                1.0f - color.g,
-                1.0f - color.b
-            );
-            image_set_pixel(image, x, y, negative);
-        }
-    }
+    filter_log("Applying negative filter\n");
+    parallel_for_rows(image->height, negative_rows, image);
 }
 
 // Sharpening filter
@@ -99,7 +179,7 @@ void filter_sharpening(Image* image, void* params) {
         return;
     }
 
-    printf("Applying sharpening filter\n");
+    filter_log("Applying sharpening filter\n");
 
     float kernel[3][3] = {
         { 0, -1,  0},
@@ -109,259 +189,304 @@ void filter_sharpening(Image* image, void* params) {
     apply_matrix_filter(image, kernel, 1.0f);
 }
 
-// Edge detection filter
-void filter_edge_detection(Image* image, void* params) {
-    if (!image || !params) {
-        fprintf(stderr, "Error: filter_edge_detection received NULL parameters\n");
+// Тиснение: разность соседей вдоль диагонали поверх исходного изображения
+void filter_emboss(Image* image, void* params) {
+    if (!image) {
+        fprintf(stderr, "Error: filter_emboss received NULL image\n");
         return;
     }
 
-    EdgeParams* edge = (EdgeParams*)params;
-    float threshold = edge->threshold;
-
-    printf("Applying edge detection with threshold %.2f\n", threshold);
-
-    // Сначала преобразуем в градации серого
-    filter_grayscale(image, NULL);
+    filter_log("Applying emboss filter\n");
 
     float kernel[3][3] = {
-        { 0, -1,  0},
-        {-1,  4, -1},
-        { 0, -1,  0}
+        {-2, -1,  0},
+        {-1,  1,  1},
+        { 0,  1,  2}
     };
-
-    // Применяем матричный фильтр
     apply_matrix_filter(image, kernel, 1.0f);
+}
 
-    // Бинаризация по порогу
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            Color color = image_get_pixel(image, x, y);
-            float value = color.r; // Все каналы одинаковы после grayscale
+typedef struct {
+    const Image* image;
+    Image* mask;         // Результат, PIXEL_FORMAT_MASK
+    float threshold;
+    Border border;
+    atomic_bool failed;  // Участку не хватило памяти, его строки не заполнены
+} EdgeContext;
+
+// Яркость, как у grayscale после перехода к float
+static inline float edge_luminance(float r, float g, float b) {
+    return clamp01(0.299f * r + 0.587f * g + 0.114f * b);
+}
 
-            if (value > threshold) {
-                image_set_pixel(image, x, y, color_create(1.0f, 1.0f, 1.0f));
-            } else {
-                image_set_pixel(image, x, y, color_create(0.0f, 0.0f, 0.0f));
-            }
+// Яркость строки y в gray[0, width)
+static void edge_luminance_row(const Image* image, int y, float* gray) {
+    int width = image->width;
+
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        const float* r = image_plane_row(image, 0, y);
+        const float* g = image_plane_row(image, 1, y);
+        const float* b = image_plane_row(image, 2, y);
+        for (int x = 0; x < width; x++) {
+            gray[x] = edge_luminance(r[x], g[x], b[x]);
+        }
+    } else if (image->format == PIXEL_FORMAT_U8) {
+        const Color8* pixels = (const Color8*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            gray[x] = edge_luminance(pixels[x].r / 255.0f, pixels[x].g / 255.0f, pixels[x].b / 255.0f);
+        }
+    } else if (image->format == PIXEL_FORMAT_U16) {
+        const Color16* pixels = (const Color16*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            gray[x] = edge_luminance(pixels[x].r / 65535.0f, pixels[x].g / 65535.0f,
+                                     pixels[x].b / 65535.0f);
+        }
+    } else if (image->format == PIXEL_FORMAT_MASK) {
+        const uint8_t* bits = image_mask_row(image, y);
+        for (int x = 0; x < width; x++) {
+            gray[x] = (bits[x / 8] >> (7 - x % 8)) & 1 ? 1.0f : 0.0f;
+        }
+    } else {
+        const Color* pixels = (const Color*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            gray[x] = edge_luminance(pixels[x].r, pixels[x].g, pixels[x].b);
         }
     }
 }
 
-// Median filter
-void filter_median(Image* image, void* params) {
-    if (!image || !params) {
-        fprintf(stderr, "Error: filter_median received NULL parameters\n");
-        return;
-    }
+// Яркость строки y с ореолом в 1 пиксель слева и справа
+static void edge_load_gray(const Image* image, int y, float* gray, Border border) {
+    edge_luminance_row(image, y, gray);
+    border_fill_row(gray, image->width, 1, border);
+}
 
-    MedianParams* med = (MedianParams*)params;
-    int window = med->window_size;
+// Строка маски: лапласиан яркости (ядро {0, -1, 0; -1, 4, -1; 0, -1, 0},
+// веса складываются в том же порядке, что и в матричном фильтре) с порогом.
+// Каждые 8 пикселей дают один байт маски.
+static void edge_mask_row(uint8_t* restrict dst, const float* rows[3], float threshold,
+                          int width, int bytes) {
+    const float* up = rows[0];
+    const float* mid = rows[1];
+    const float* down = rows[2];
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        float value[8];
+
+        for (int l = 0; l < 8; l++) {
+            int i = x + l;
+            float sum = -up[i];
+            sum -= mid[i - 1];
+            sum += 4.0f * mid[i];
+            sum -= mid[i + 1];
+            sum -= down[i];
+            value[l] = clamp01(sum);
+        }
 
-    if (window % 2 == 0 || window < 1) {
-        fprintf(stderr, "Error: Median filter window size must be odd and positive (got %d)\n", window);
-        return;
+        uint8_t bits = 0;
+        for (int l = 0; l < 8; l++) {
+            bits |= (uint8_t)((value[l] > threshold) << (7 - l));
+        }
+        dst[x / 8] = bits;
     }
 
-    printf("Applying median filter with window size %d\n", window);
+    // Неполный байт в конце строки и выравнивание строки заполняются нулями
+    if (x < width) {
+        uint8_t bits = 0;
+        for (int i = x; i < width; i++) {
+            float sum = -up[i];
+            sum -= mid[i - 1];
+            sum += 4.0f * mid[i];
+            sum -= mid[i + 1];
+            sum -= down[i];
+            bits |= (uint8_t)((clamp01(sum) > threshold) << (7 - (i - x)));
+        }
+        dst[x / 8] = bits;
+        x += 8;
+    }
 
-    int half = window / 2;
-    Image* temp = image_copy(image);
-    if (!temp) {
-        fprintf(stderr, "Error: Cannot create temporary image for median filter\n");
+    for (int i = x / 8; i < bytes; i++) {
+        dst[i] = 0;
+    }
+}
+
+// Строки [y_begin, y_end) маски границ. Строки яркости окна 3x3 хранятся
+// в трех слотах и считаются по одному разу на участок.
+static void edge_rows(void* context, int y_begin, int y_end) {
+    EdgeContext* ctx = (EdgeContext*)context;
+    const Image* image = ctx->image;
+    int width = image->width;
+    size_t row_size = (size_t)width + 2;
+
+    float* buffer = (float*)malloc(sizeof(float) * row_size * 4);
+    if (!buffer) {
+        fprintf(stderr, "Error: Memory allocation failed for edge detection\n");
+        atomic_store(&ctx->failed, true);
         return;
     }
 
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            // Сбор цветов в окрестности
-            int count = 0;
-            Color* colors = (Color*)malloc(sizeof(Color) * window * window);
-            if (!colors) {
-                fprintf(stderr, "Error: Memory allocation failed for median filter\n");
-                image_destroy(temp);
-                return;
-            }
+    float* slots[3] = {buffer + 1, buffer + row_size + 1, buffer + 2 * row_size + 1};
+    int loaded[3] = {-1, -1, -1};
 
-            for (int dy = -half; dy <= half; dy++) {
-                for (int dx = -half; dx <= half; dx++) {
-                    int nx = x + dx;
-                    int ny = y + dy;
+    // Строка за краем при BORDER_CONSTANT
+    float* constant = buffer + 3 * row_size + 1;
+    for (int x = -1; x <= width; x++) {
+        constant[x] = ctx->border.value;
+    }
 
-                    // Обработка границ: используем ближайший пиксель
-                    if (nx < 0) nx = 0;
-                    if (nx >= image->width) nx = image->width - 1;
-                    if (ny < 0) ny = 0;
-                    if (ny >= image->height) ny = image->height - 1;
+    for (int y = y_begin; y < y_end; y++) {
+        int needed[3];
+        const float* rows[3];
 
-                    colors[count++] = image_get_pixel(temp, nx, ny);
-                }
-            }
+        for (int k = 0; k < 3; k++) {
+            needed[k] = border_index(y + k - 1, image->height, ctx->border.mode);
+        }
 
-            // Сортировка для нахождения медианы (отдельно по каналам)
-            // Простая bubble sort для каждого канала
-            float r_vals[count], g_vals[count], b_vals[count];
-            for (int i = 0; i < count; i++) {
-                r_vals[i] = colors[i].r;
-                g_vals[i] = colors[i].g;
-                b_vals[i] = colors[i].b;
+        for (int k = 0; k < 3; k++) {
+            if (needed[k] < 0) {
+                rows[k] = constant;
+                continue;
             }
 
-            // Сортировка красного канала
-            for (int i = 0; i < count - 1; i++) {
-                for (int j = i + 1; j < count; j++) {
-                    if (r_vals[i] > r_vals[j]) {
-                        float temp_val = r_vals[i];
-                        r_vals[i] = r_vals[j];
-                        r_vals[j] = temp_val;
-                    }
+            int slot = -1;
+            for (int s = 0; s < 3; s++) {
+                if (loaded[s] == needed[k]) {
+                    slot = s;
                 }
             }
 
-            // Сортировка зеленого канала
-            for (int i = 0; i < count - 1; i++) {
-                for (int j = i + 1; j < count; j++) {
-                    if (g_vals[i] > g_vals[j]) {
-                        float temp_val = g_vals[i];
-                        g_vals[i] = g_vals[j];
-                        g_vals[j] = temp_val;
-                    }
+            // Новая строка занимает слот, не нужный текущему окну
+            for (int s = 0; s < 3 && slot < 0; s++) {
+                bool used = false;
+                for (int j = 0; j < 3; j++) {
+                    used = used || (needed[j] >= 0 && loaded[s] == needed[j]);
                 }
-            }
 
-            // Сортировка синего канала
-            for (int i = 0; i < count - 1; i++) {
-                for (int j = i + 1; j < count; j++) {
-                    if (b_vals[i] > b_vals[j]) {
-                        float temp_val = b_vals[i];
-                        b_vals[i] = b_vals[j];
-                        b_vals[j] = temp_val;
-                    }
+                if (!used) {
+                    slot = s;
+                    edge_load_gray(image, needed[k], slots[s], ctx->border);
+                    loaded[s] = needed[k];
                 }
             }
 
-            Color median = color_create(
-                r_vals[count / 2],
-                g_vals[count / 2],
-                b_vals[count / 2]
-            );
-
-            image_set_pixel(image, x, y, median);
-            free(colors);
+            rows[k] = slots[slot];
         }
+
+        edge_mask_row(image_mask_row(ctx->mask, y), rows, ctx->threshold, width,
+                      ctx->mask->stride / 8);
     }
 
-    image_destroy(temp);
+    free(buffer);
 }
 
-// Gaussian blur filter
-void filter_gaussian_blur(Image* image, void* params) {
+// Edge detection filter
+void filter_edge_detection(Image* image, void* params) {
     if (!image || !params) {
-        fprintf(stderr, "Error: filter_gaussian_blur received NULL parameters\n");
+        fprintf(stderr, "Error: filter_edge_detection received NULL parameters\n");
         return;
     }
 
-    BlurParams* blur = (BlurParams*)params;
-    float sigma = blur->sigma;
-
-    if (sigma <= 0) {
-        fprintf(stderr, "Error: Gaussian blur sigma must be positive (got %.2f)\n", sigma);
-        return;
-    }
+    EdgeParams* edge = (EdgeParams*)params;
+    float threshold = edge->threshold;
 
-    printf("Applying Gaussian blur with sigma %.2f\n", sigma);
-    apply_gaussian_blur(image, sigma);
-}
+    filter_log("Applying edge detection with threshold %.2f\n", threshold);
 
-// Sepia filter (дополнительный)
-void filter_sepia(Image* image, void* params) {
-    if (!image) {
-        fprintf(stderr, "Error: filter_sepia received NULL image\n");
+    // Яркость, лапласиан и порог - за один проход по изображению; результат
+    // совпадает с grayscale, матричным фильтром и бинаризацией по очереди,
+    // но хранится битовой маской
+    Image* mask = image_create_format(image->width, image->height, PIXEL_FORMAT_MASK);
+    if (!mask) {
         return;
     }
 
-    printf("Applying sepia filter\n");
-
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            Color color = image_get_pixel(image, x, y);
-
-            // Формула сепии
-            float new_r = color.r * 0.393f + color.g * 0.769f + color.b * 0.189f;
-            float new_g = color.r * 0.349f + color.g * 0.686f + color.b * 0.168f;
-            float new_b = color.r * 0.272f + color.g * 0.534f + color.b * 0.131f;
-
-            Color sepia = color_create(new_r, new_g, new_b);
-            image_set_pixel(image, x, y, sepia);
-        }
-    }
-}
-
-// Vignette filter (дополнительный)
-void filter_vignette(Image* image, void* params) {
-    if (!image) {
-        fprintf(stderr, "Error: filter_vignette received NULL image\n");
+    EdgeContext context;
+    context.image = image;
+    context.mask = mask;
+    context.threshold = threshold;
+    context.border = filters_border;
+    atomic_init(&context.failed, false);
+    parallel_for_rows(image->height, edge_rows, &context);
+
+    // Незаполненные строки маски из пула содержат мусор: изображение не меняется
+    if (atomic_load(&context.failed)) {
+        image_destroy(mask);
         return;
     }
 
-    VignetteParams* vignette = (VignetteParams*)params;
-    float intensity = vignette ? vignette->intensity : 0.8f;
-
-    if (intensity < 0 || intensity > 1) {
-        fprintf(stderr, "Warning: Vignette intensity should be between 0 and 1 (got %.2f)\n", intensity);
-        intensity = intensity < 0 ? 0 : (intensity > 1 ? 1 : intensity);
-    }
-
-    printf("Applying vignette filter with intensity %.2f\n", intensity);
-
-    float center_x = image->width / 2.0f;
-    float center_y = image->height / 2.0f;
-    float max_distance = sqrtf(center_x * center_x + center_y * center_y);
-
-    if (max_distance < 1.0f) max_distance = 1.0f;
-
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            Color color = image_get_pixel(image, x, y);
-
-            float dx = x - center_x;
-            float dy = y - center_y;
-            float distance = sqrtf(dx * dx + dy * dy);
-            float factor = 1.0f - (distance / max_distance) * intensity;
-
-            if (factor < 0.0f) factor = 0.0f;
+    image_take(image, mask);
+}
 
-            Color vignetted = color_create(
-                color.r * factor,
-                color.g * factor,
-                color.b * factor
-            );
+typedef struct {
+    Image* image;
+    const Image* temp;   // Копия исходного изображения
+    int window;
+    atomic_bool failed;  // Участку не хватило памяти, его строки не заполнены
+} MedianContext;
+
+// k-й по возрастанию элемент values (частичная сортировка на месте)
+static float median_select(float* values, int count, int k) {
+    int left = 0;
+    int right = count - 1;
+
+    while (left < right) {
+        float pivot = values[(left + right) / 2];
+        int i = left;
+        int j = right;
+
+        while (i <= j) {
+            while (values[i] < pivot) i++;
+            while (values[j] > pivot) j--;
+            if (i <= j) {
+                float swap = values[i];
+                values[i] = values[j];
+                values[j] = swap;
+                i++;
+                j--;
+            }
+        }
 
-            image_set_pixel(image, x, y, vignetted);
+        if (k <= j) {
+            right = j;
+        } else if (k >= i) {
+            left = i;
+        } else {
+            break;
         }
     }
+
+    return values[k];
 }
 
-// Вспомогательная функция для применения матричного фильтра
-void apply_matrix_filter(Image* image, float kernel[3][3], float divisor) {
-    if (!image) {
-        return;
-    }
+// Строки [y_begin, y_end) медианного фильтра (любой формат)
+static void median_rows(void* context, int y_begin, int y_end) {
+    MedianContext* ctx = (MedianContext*)context;
+    Image* image = ctx->image;
+    const Image* temp = ctx->temp;
+    int window = ctx->window;
+    int half = window / 2;
+    int count = window * window;
 
-    Image* temp = image_copy(image);
-    if (!temp) {
+    // Буферы окрестности один раз на участок строк
+    float* values = (float*)malloc(sizeof(float) * 3 * count);
+    if (!values) {
+        fprintf(stderr, "Error: Memory allocation failed for median filter\n");
+        atomic_store(&ctx->failed, true);
         return;
     }
 
-    for (int y = 0; y < image->height; y++) {
+    float* r_vals = values;
+    float* g_vals = values + count;
+    float* b_vals = values + 2 * count;
+
+    for (int y = y_begin; y < y_end; y++) {
         for (int x = 0; x < image->width; x++) {
-            Color sum = color_create(0, 0, 0);
-            float total_weight = 0.0f;
+            // Сбор цветов в окрестности
+            int n = 0;
 
-            for (int ky = -1; ky <= 1; ky++) {
-                for (int kx = -1; kx <= 1; kx++) {
-                    int nx = x + kx;
-                    int ny = y + ky;
+            for (int dy = -half; dy <= half; dy++) {
+                for (int dx = -half; dx <= half; dx++) {
+                    int nx = x + dx;
+                    int ny = y + dy;
 
                     // Обработка границ: используем ближайший пиксель
                     if (nx < 0) nx = 0;
@@ -369,119 +494,2458 @@ void apply_matrix_filter(Image* image, float kernel[3][3], float divisor) {
                     if (ny < 0) ny = 0;
                     if (ny >= image->height) ny = image->height - 1;
 
-                    Color pixel = image_get_pixel(temp, nx, ny);
-                    float weight = kernel[ky + 1][kx + 1];
-
-                    sum = color_add(sum, color_mul(pixel, weight));
-                    total_weight += weight;
+                    Color color = image_get_pixel(temp, nx, ny);
+                    r_vals[n] = color.r;
+                    g_vals[n] = color.g;
+                    b_vals[n] = color.b;
+                    n++;
                 }
             }
 
-            if (divisor != 0) {
-                sum = color_mul(sum, 1.0f / divisor);
-            } else if (total_weight != 0) {
-                sum = color_mul(sum, 1.0f / total_weight);
-            }
+            // Медиана каждого канала - элемент count / 2 по возрастанию
+            Color median = color_create(
+                median_select(r_vals, count, count / 2),
+                median_select(g_vals, count, count / 2),
+                median_select(b_vals, count, count / 2)
+            );
 
-            image_set_pixel(image, x, y, sum);
+            image_set_pixel(image, x, y, median);
         }
     }
 
-    image_destroy(temp);
+    free(values);
 }
 
-// Вспомогательная функция для гауссова размытия
-void apply_gaussian_blur(Image* image, float sigma) {
-    if (!image || sigma <= 0) {
-        return;
+// Сети сравнений для медианы окон 3x3 и 5x5 (Devillard, 1998): после
+// обменов пар (a, b) так, что в a меньшее значение, медиана оказывается
+// в центральном элементе. Обмены выполняются без ветвлений сразу для
+// SIMD_LANES соседних пикселей.
+static const uint8_t MEDIAN9_NETWORK[][2] = {
+    {1, 2}, {4, 5}, {7, 8}, {0, 1}, {3, 4}, {6, 7}, {1, 2}, {4, 5}, {7, 8}, {0, 3},
+    {5, 8}, {4, 7}, {3, 6}, {1, 4}, {2, 5}, {4, 7}, {4, 2}, {6, 4}, {4, 2}
+};
+
+static const uint8_t MEDIAN25_NETWORK[][2] = {
+    {0, 1}, {3, 4}, {2, 4}, {2, 3}, {6, 7}, {5, 7}, {5, 6}, {9, 10}, {8, 10}, {8, 9},
+    {12, 13}, {11, 13}, {11, 12}, {15, 16}, {14, 16}, {14, 15}, {18, 19}, {17, 19}, {17, 18}, {21, 22},
+    {20, 22}, {20, 21}, {23, 24}, {2, 5}, {3, 6}, {0, 6}, {0, 3}, {4, 7}, {1, 7}, {1, 4},
+    {11, 14}, {8, 14}, {8, 11}, {12, 15}, {9, 15}, {9, 12}, {13, 16}, {10, 16}, {10, 13}, {20, 23},
+    {17, 23}, {17, 20}, {21, 24}, {18, 24}, {18, 21}, {19, 22}, {8, 17}, {9, 18}, {0, 18}, {0, 9},
+    {10, 19}, {1, 19}, {1, 10}, {11, 20}, {2, 20}, {2, 11}, {12, 21}, {3, 21}, {3, 12}, {13, 22},
+    {4, 22}, {4, 13}, {14, 23}, {5, 23}, {5, 14}, {15, 24}, {6, 24}, {6, 15}, {7, 16}, {7, 19},
+    {13, 21}, {15, 23}, {7, 13}, {7, 15}, {1, 9}, {3, 11}, {5, 17}, {11, 17}, {9, 17}, {4, 10},
+    {6, 12}, {7, 14}, {4, 6}, {4, 7}, {12, 14}, {10, 14}, {6, 7}, {10, 12}, {6, 10}, {6, 17},
+    {12, 17}, {7, 17}, {7, 10}, {12, 18}, {7, 12}, {10, 18}, {12, 20}, {10, 20}, {10, 12}
+};
+
+// Канал c строки y (кроме формата U8) без нормирования в dst[half, half + width). Края
+// дополняются крайними пикселями, поэтому ядро не проверяет границы.
+static void median_load_channel(const Image* image, int y, int c, float* dst, int half) {
+    int width = image->width;
+    float* row = dst + half;
+
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        memcpy(row, image_plane_row(image, c, y), sizeof(float) * width);
+    } else if (image->format == PIXEL_FORMAT_U16) {
+        const uint16_t* pixels = (const uint16_t*)((const Color16*)image->data + (size_t)image->stride * y);
+        for (int x = 0; x < width; x++) {
+            row[x] = pixels[3 * x + c];
+        }
+    } else {
+        const float* pixels = (const float*)((const Color*)image->data + (size_t)image->stride * y);
+        for (int x = 0; x < width; x++) {
+            row[x] = pixels[3 * x + c];
+        }
     }
 
-    // Рассчитываем размер ядра (3σ в каждую сторону)
-    int kernel_radius = (int)ceil(3 * sigma);
-    int kernel_size = kernel_radius * 2 + 1;
-
-    float* kernel = (float*)malloc(sizeof(float) * kernel_size);
-    if (!kernel) {
-        fprintf(stderr, "Error: Memory allocation failed for Gaussian kernel\n");
-        return;
+    for (int i = 0; i < half; i++) {
+        dst[i] = row[0];
+        row[width + i] = row[width - 1];
     }
+}
 
-    // Создаем 1D ядро Гаусса
-    float sum = 0.0f;
-    float two_sigma_sq = 2 * sigma * sigma;
+// Запись медиан канала c в строку y (как image_set_pixel для тех же значений)
+static void median_store_channel(Image* image, int y, int c, const float* values) {
+    int width = image->width;
 
-    for (int i = 0; i < kernel_size; i++) {
-        int x = i - kernel_radius;
-        kernel[i] = expf(-(x * x) / two_sigma_sq);
-        sum += kernel[i];
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        float* row = image_plane_row(image, c, y);
+        for (int x = 0; x < width; x++) {
+            row[x] = clamp01(values[x]);
+        }
+    } else if (image->format == PIXEL_FORMAT_U16) {
+        uint16_t* pixels = (uint16_t*)((Color16*)image->data + (size_t)image->stride * y);
+        for (int x = 0; x < width; x++) {
+            pixels[3 * x + c] = (uint16_t)values[x];
+        }
+    } else {
+        float* pixels = (float*)((Color*)image->data + (size_t)image->stride * y);
+        for (int x = 0; x < width; x++) {
+            pixels[3 * x + c] = clamp01(values[x]);
+        }
     }
+}
 
-    // Нормализация
-    for (int i = 0; i < kernel_size; i++) {
-        kernel[i] /= sum;
+// Обмен пары сети сравнений: в a меньшие значения, в b большие
+static inline void median_sort_lanes(float* restrict a, float* restrict b) {
+    for (int l = 0; l < SIMD_LANES; l++) {
+        float lo = a[l] < b[l] ? a[l] : b[l];
+        float hi = a[l] < b[l] ? b[l] : a[l];
+        a[l] = lo;
+        b[l] = hi;
     }
+}
 
-    // Применяем раздельно по горизонтали и вертикали
-    Image* temp = image_copy(image);
-    if (!temp) {
-        free(kernel);
-        return;
+// Медианы строки по сети сравнений: rows - window строк окна с дополненными краями
+static void median_network_row(const float* const* rows, int window, int width, float* out) {
+    const uint8_t (*network)[2] = window == 3 ? MEDIAN9_NETWORK : MEDIAN25_NETWORK;
+    int pairs = window == 3 ? (int)(sizeof(MEDIAN9_NETWORK) / sizeof(MEDIAN9_NETWORK[0])) :
+                              (int)(sizeof(MEDIAN25_NETWORK) / sizeof(MEDIAN25_NETWORK[0]));
+    int count = window * window;
+
+    // Строки дополнены на блок значений, поэтому последний блок тоже полный
+    for (int x = 0; x < width; x += SIMD_LANES) {
+        float p[25][SIMD_LANES];
+
+        for (int k = 0; k < count; k++) {
+            memcpy(p[k], rows[k / window] + x + k % window, sizeof(float) * SIMD_LANES);
+        }
+
+        for (int i = 0; i < pairs; i++) {
+            median_sort_lanes(p[network[i][0]], p[network[i][1]]);
+        }
+
+        memcpy(out + x, p[count / 2], sizeof(float) * SIMD_LANES);
     }
+}
 
-    // Горизонтальное размытие
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            Color sum_color = color_create(0, 0, 0);
+// Байтовых элементов за итерацию: столько же векторных регистров, сколько у float
+#define MEDIAN_BYTE_LANES (SIMD_LANES * 4)
 
-            for (int k = -kernel_radius; k <= kernel_radius; k++) {
-                int nx = x + k;
-                if (nx < 0) nx = 0;
-                if (nx >= image->width) nx = image->width - 1;
+// Канал c строки y изображения U8 в dst[half, half + width) с дополненными краями
+static void median_load_channel8(const Image* image, int y, int c, uint8_t* dst, int half) {
+    int width = image->width;
+    const uint8_t* pixels = (const uint8_t*)((const Color8*)image->data + (size_t)image->stride * y);
+    uint8_t* row = dst + half;
 
-                Color pixel = image_get_pixel(temp, nx, y);
-                sum_color = color_add(sum_color, color_mul(pixel, kernel[k + kernel_radius]));
-            }
+    for (int x = 0; x < width; x++) {
+        row[x] = pixels[3 * x + c];
+    }
 
-            image_set_pixel(image, x, y, sum_color);
-        }
+    for (int i = 0; i < half; i++) {
+        dst[i] = row[0];
+        row[width + i] = row[width - 1];
     }
+}
 
-    // Копируем результат для вертикального размытия
-    memcpy(temp->data, image->data, sizeof(Color) * image->width * image->height);
+static inline void median_sort_lanes8(uint8_t* restrict a, uint8_t* restrict b) {
+    for (int l = 0; l < MEDIAN_BYTE_LANES; l++) {
+        uint8_t lo = a[l] < b[l] ? a[l] : b[l];
+        uint8_t hi = a[l] < b[l] ? b[l] : a[l];
+        a[l] = lo;
+        b[l] = hi;
+    }
+}
 
-    // Вертикальное размытие
-    for (int y = 0; y < image->height; y++) {
-        for (int x = 0; x < image->width; x++) {
-            Color sum_color = color_create(0, 0, 0);
+// median_network_row для байтов: в векторном регистре вчетверо больше пикселей
+static void median_network_row8(const uint8_t* const* rows, int window, int width, uint8_t* out) {
+    const uint8_t (*network)[2] = window == 3 ? MEDIAN9_NETWORK : MEDIAN25_NETWORK;
+    int pairs = window == 3 ? (int)(sizeof(MEDIAN9_NETWORK) / sizeof(MEDIAN9_NETWORK[0])) :
+                              (int)(sizeof(MEDIAN25_NETWORK) / sizeof(MEDIAN25_NETWORK[0]));
+    int count = window * window;
 
-            for (int k = -kernel_radius; k <= kernel_radius; k++) {
-                int ny = y + k;
-                if (ny < 0) ny = 0;
-                if (ny >= image->height) ny = image->height - 1;
+    for (int x = 0; x < width; x += MEDIAN_BYTE_LANES) {
+        uint8_t p[25][MEDIAN_BYTE_LANES];
 
-                Color pixel = image_get_pixel(temp, x, ny);
-                sum_color = color_add(sum_color, color_mul(pixel, kernel[k + kernel_radius]));
-            }
+        for (int k = 0; k < count; k++) {
+            memcpy(p[k], rows[k / window] + x + k % window, MEDIAN_BYTE_LANES);
+        }
 
-            image_set_pixel(image, x, y, sum_color);
+        for (int i = 0; i < pairs; i++) {
+            median_sort_lanes8(p[network[i][0]], p[network[i][1]]);
         }
-    }
 
-    image_destroy(temp);
-    free(kernel);
+        memcpy(out + x, p[count / 2], MEDIAN_BYTE_LANES);
+    }
 }
 
-// Вспомогательная функция для нахождения медианного цвета
-Color get_median_color(Color* colors, int count) {
-    if (count <= 0) {
-        return color_create(0, 0, 0);
+// Строки [y_begin, y_end) медианного фильтра с окном 3 или 5 по сетям сравнений.
+// Изображения U8 обрабатываются байтами, остальные форматы - значениями float.
+static void median_network_rows(void* context, int y_begin, int y_end) {
+    MedianContext* ctx = (MedianContext*)context;
+    Image* image = ctx->image;
+    const Image* temp = ctx->temp;
+    int window = ctx->window;
+    int half = window / 2;
+    int width = image->width;
+    bool bytes = image->format == PIXEL_FORMAT_U8;
+    size_t element = bytes ? 1 : sizeof(float);
+
+    // Строки окна каждого канала хранятся по кругу: строка r в ячейке r % window.
+    // Дополнение на блок элементов позволяет ядру не проверять конец строки.
+    size_t padded = (size_t)(width + 2 * half + MEDIAN_BYTE_LANES) * element;
+    uint8_t* buffer = (uint8_t*)calloc(3 * window + 1, padded);
+    if (!buffer) {
+        fprintf(stderr, "Error: Memory allocation failed for median filter\n");
+        atomic_store(&ctx->failed, true);
+        return;
     }
 
-    // Простая реализация - возвращаем средний цвет
+    uint8_t* out = buffer + padded * 3 * window;
+    int loaded[5];
+    for (int i = 0; i < window; i++) {
+        loaded[i] = -1;
+    }
+
+    for (int y = y_begin; y < y_end; y++) {
+        const uint8_t* rows[3][5];
+
+        for (int dy = -half; dy <= half; dy++) {
+            int source = y + dy < 0 ? 0 : (y + dy >= image->height ? image->height - 1 : y + dy);
+            int slot = source % window;
+
+            for (int c = 0; c < 3; c++) {
+                uint8_t* row = buffer + padded * (c * window + slot);
+                if (loaded[slot] != source) {
+                    if (bytes) {
+                        median_load_channel8(temp, source, c, row, half);
+                    } else {
+                        median_load_channel(temp, source, c, (float*)row, half);
+                    }
+                }
+                rows[c][dy + half] = row;
+            }
+            loaded[slot] = source;
+        }
+
+        for (int c = 0; c < 3; c++) {
+            if (bytes) {
+                median_network_row8(rows[c], window, width, out);
+
+                uint8_t* pixels = (uint8_t*)((Color8*)image->data + (size_t)image->stride * y);
+                for (int x = 0; x < width; x++) {
+                    pixels[3 * x + c] = out[x];
+                }
+            } else {
+                const float* float_rows[5];
+                for (int k = 0; k < window; k++) {
+                    float_rows[k] = (const float*)rows[c][k];
+                }
+
+                median_network_row(float_rows, window, width, (float*)out);
+                median_store_channel(image, y, c, (const float*)out);
+            }
+        }
+    }
+
+    free(buffer);
+}
+
+// Гистограмма 8-битного канала: 16 грубых корзин по 16 значений и 256 точных
+typedef struct {
+    uint16_t coarse[16];
+    uint16_t fine[256];
+} MedianHistogram;
+
+// Гистограммы столбцов окна для одного канала
+static inline void median_column_add(MedianHistogram* column, uint8_t value, uint16_t delta) {
+    column->coarse[value >> 4] += delta;
+    column->fine[value] += delta;
+}
+
+// Добавление (delta = 1) или удаление (delta = 0xFFFF) строки y в гистограммах столбцов
+static void median_columns_update(MedianHistogram* columns[3], const Image* image, int y, uint16_t delta) {
+    const Color8* row = (const Color8*)image->data + (size_t)image->stride * y;
+
+    for (int x = 0; x < image->width; x++) {
+        median_column_add(&columns[0][x], row[x].r, delta);
+        median_column_add(&columns[1][x], row[x].g, delta);
+        median_column_add(&columns[2][x], row[x].b, delta);
+    }
+}
+
+// Медиана канала в столбце x. Грубая гистограмма окна обновляется для
+// каждого x, точная часть корзины k - только когда медиана попадает
+// в нее: сдвигом от столбца fine_x[k] или пересчетом, если он далеко.
+static uint8_t median_histogram_select(MedianHistogram* kernel, int* fine_x,
+                                       const MedianHistogram* columns, int width,
+                                       int half, int x, int rank) {
+    int sum = 0;
+    int k = 0;
+    while (sum + kernel->coarse[k] <= rank) {
+        sum += kernel->coarse[k];
+        k++;
+    }
+
+    uint16_t* fine = kernel->fine + k * 16;
+
+    if (x - fine_x[k] > 2 * half) {
+        memset(fine, 0, sizeof(uint16_t) * 16);
+        for (int j = x - half; j <= x + half; j++) {
+            const uint16_t* column = columns[clamp_index(j, width - 1)].fine + k * 16;
+            for (int v = 0; v < 16; v++) {
+                fine[v] += column[v];
+            }
+        }
+    } else {
+        for (int j = fine_x[k] + 1; j <= x; j++) {
+            const uint16_t* added = columns[clamp_index(j + half, width - 1)].fine + k * 16;
+            const uint16_t* removed = columns[clamp_index(j - half - 1, width - 1)].fine + k * 16;
+            for (int v = 0; v < 16; v++) {
+                fine[v] += added[v] - removed[v];
+            }
+        }
+    }
+    fine_x[k] = x;
+
+    int v = 0;
+    while (sum + fine[v] <= rank) {
+        sum += fine[v];
+        v++;
+    }
+
+    return (uint8_t)(k * 16 + v);
+}
+
+// Строки [y_begin, y_end) медианного фильтра для формата U8 по скользящим
+// гистограммам (Perreault, Hebert, 2007): время на пиксель не зависит от окна
+static void median_histogram_rows(void* context, int y_begin, int y_end) {
+    MedianContext* ctx = (MedianContext*)context;
+    Image* image = ctx->image;
+    const Image* temp = ctx->temp;
+    int width = image->width;
+    int half = ctx->window / 2;
+    int rank = ctx->window * ctx->window / 2;
+
+    MedianHistogram* buffer = (MedianHistogram*)calloc((size_t)width * 3, sizeof(MedianHistogram));
+    if (!buffer) {
+        fprintf(stderr, "Error: Memory allocation failed for median filter\n");
+        atomic_store(&ctx->failed, true);
+        return;
+    }
+
+    MedianHistogram* columns[3] = {buffer, buffer + width, buffer + 2 * width};
+
+    // Столбцы окна первой строки участка; строки за краем повторяют крайнюю
+    for (int dy = -half; dy <= half; dy++) {
+        median_columns_update(columns, temp, clamp_index(y_begin + dy, image->height - 1), 1);
+    }
+
+    for (int y = y_begin; y < y_end; y++) {
+        if (y > y_begin) {
+            median_columns_update(columns, temp, clamp_index(y - half - 1, image->height - 1), 0xFFFF);
+            median_columns_update(columns, temp, clamp_index(y + half, image->height - 1), 1);
+        }
+
+        Color8* row = (Color8*)image->data + (size_t)image->stride * y;
+
+        for (int c = 0; c < 3; c++) {
+            MedianHistogram kernel;
+            int fine_x[16];
+
+            memset(kernel.coarse, 0, sizeof(kernel.coarse));
+            for (int k = 0; k < 16; k++) {
+                fine_x[k] = -2 * half - 2;
+            }
+
+            for (int j = -half; j <= half; j++) {
+                const uint16_t* coarse = columns[c][clamp_index(j, width - 1)].coarse;
+                for (int k = 0; k < 16; k++) {
+                    kernel.coarse[k] += coarse[k];
+                }
+            }
+
+            for (int x = 0; x < width; x++) {
+                if (x > 0) {
+                    const uint16_t* added = columns[c][clamp_index(x + half, width - 1)].coarse;
+                    const uint16_t* removed = columns[c][clamp_index(x - half - 1, width - 1)].coarse;
+                    for (int k = 0; k < 16; k++) {
+                        kernel.coarse[k] += added[k] - removed[k];
+                    }
+                }
+
+                uint8_t median = median_histogram_select(&kernel, fine_x, columns[c],
+                                                         width, half, x, rank);
+                if (c == 0) row[x].r = median;
+                else if (c == 1) row[x].g = median;
+                else row[x].b = median;
+            }
+        }
+    }
+
+    free(buffer);
+}
+
+// Median filter
+void filter_median(Image* image, void* params) {
+    if (!image || !params) {
+        fprintf(stderr, "Error: filter_median received NULL parameters\n");
+        return;
+    }
+
+    MedianParams* med = (MedianParams*)params;
+    int window = med->window_size;
+
+    if (window % 2 == 0 || window < 1) {
+        fprintf(stderr, "Error: Median filter window size must be odd and positive (got %d)\n", window);
+        return;
+    }
+
+    filter_log("Applying median filter with window size %d\n", window);
+
+    // Медиана выбирает одно из исходных значений, поэтому работает
+    // в любом формате хранения без перехода к float
+
+    Image* temp = image_copy(image);
+    if (!temp) {
+        fprintf(stderr, "Error: Cannot create temporary image for median filter\n");
+        return;
+    }
+
+    // Окна 3 и 5 - сети сравнений, большие окна 8-битных изображений - гистограммы,
+    // иначе выбор из окрестности. Счетчики гистограмм 16-битные, поэтому окно не больше 255.
+    MedianContext context;
+    context.image = image;
+    context.temp = temp;
+    context.window = window;
+    atomic_init(&context.failed, false);
+
+    if (window == 3 || window == 5) {
+        parallel_for_rows(image->height, median_network_rows, &context);
+    } else if (image->format == PIXEL_FORMAT_U8 && window >= MEDIAN_HISTOGRAM_MIN_WINDOW && window <= 255) {
+        parallel_for_rows(image->height, median_histogram_rows, &context);
+    } else {
+        parallel_for_rows(image->height, median_rows, &context);
+    }
+
+    // Часть строк осталась без медианы: возвращается исходное изображение
+    if (atomic_load(&context.failed)) {
+        image_take(image, temp);
+        return;
+    }
+
+    image_destroy(temp);
+}
+
+// Gaussian blur filter
+void filter_gaussian_blur(Image* image, void* params) {
+    if (!image || !params) {
+        fprintf(stderr, "Error: filter_gaussian_blur received NULL parameters\n");
+        return;
+    }
+
+    BlurParams* blur = (BlurParams*)params;
+    float sigma = blur->sigma;
+
+    if (sigma <= 0) {
+        fprintf(stderr, "Error: Gaussian blur sigma must be positive (got %.2f)\n", sigma);
+        return;
+    }
+
+    if (blur->mode == BLUR_BOX) {
+        filter_log("Applying box approximation of Gaussian blur with sigma %.2f\n", sigma);
+        apply_box_gaussian_blur(image, sigma);
+        return;
+    }
+
+    filter_log("Applying Gaussian blur with sigma %.2f\n", sigma);
+    apply_gaussian_blur(image, sigma);
+}
+
+// Формула сепии для одного пикселя плоскостей
+static inline void sepia_pixel(float* r, float* g, float* b) {
+    float cr = *r;
+    float cg = *g;
+    float cb = *b;
+
+    *r = clamp01(cr * 0.393f + cg * 0.769f + cb * 0.189f);
+    *g = clamp01(cr * 0.349f + cg * 0.686f + cb * 0.168f);
+    *b = clamp01(cr * 0.272f + cg * 0.534f + cb * 0.131f);
+}
+
+// Строки [y_begin, y_end) фильтра sepia (формат PLANAR)
+static void sepia_rows(void* context, int y_begin, int y_end) {
+    Image* image = (Image*)context;
+
+    for (int y = y_begin; y < y_end; y++) {
+        float* restrict r = image_plane_row(image, 0, y);
+        float* restrict g = image_plane_row(image, 1, y);
+        float* restrict b = image_plane_row(image, 2, y);
+        int x = 0;
+
+        // Блоки по SIMD_LANES пикселей, затем остаток строки
+        for (; x + SIMD_LANES <= image->width; x += SIMD_LANES) {
+            for (int l = 0; l < SIMD_LANES; l++) {
+                sepia_pixel(&r[x + l], &g[x + l], &b[x + l]);
+            }
+        }
+
+        for (; x < image->width; x++) {
+            sepia_pixel(&r[x], &g[x], &b[x]);
+        }
+    }
+}
+
+// Sepia filter (дополнительный)
+void filter_sepia(Image* image, void* params) {
+    if (!image) {
+        fprintf(stderr, "Error: filter_sepia received NULL image\n");
+        return;
+    }
+
+    filter_log("Applying sepia filter\n");
+
+    if (!image_convert(image, PIXEL_FORMAT_PLANAR)) {
+        return;
+    }
+
+    parallel_for_rows(image->height, sepia_rows, image);
+}
+
+// Vignette filter (дополнительный)
+void filter_vignette(Image* image, void* params) {
+    if (!image) {
+        fprintf(stderr, "Error: filter_vignette received NULL image\n");
+        return;
+    }
+
+    VignetteParams* vignette = (VignetteParams*)params;
+    float intensity = vignette ? vignette->intensity : 0.8f;
+
+    if (intensity < 0 || intensity > 1) {
+        fprintf(stderr, "Warning: Vignette intensity should be between 0 and 1 (got %.2f)\n", intensity);
+        intensity = intensity < 0 ? 0 : (intensity > 1 ? 1 : intensity);
+    }
+
+    filter_log("Applying vignette filter with intensity %.2f\n", intensity);
+    apply_vignette(image, intensity, 0, 0, image->width, image->height);
+}
+
+typedef struct {
+    Image* image;
+    float intensity;
+    int x_offset;
+    int y_offset;
+    float center_x;
+    float center_y;
+    float max_distance;
+} VignetteContext;
+
+// Строки [y_begin, y_end) виньетирования
+static void vignette_rows(void* context, int y_begin, int y_end) {
+    VignetteContext* ctx = (VignetteContext*)context;
+    Image* image = ctx->image;
+
+    for (int y = y_begin; y < y_end; y++) {
+        for (int x = 0; x < image->width; x++) {
+            Color color = image_get_pixel(image, x, y);
+
+            float dx = x + ctx->x_offset - ctx->center_x;
+            float dy = y + ctx->y_offset - ctx->center_y;
+            float distance = sqrtf(dx * dx + dy * dy);
+            float factor = 1.0f - (distance / ctx->max_distance) * ctx->intensity;
+
+            if (factor < 0.0f) factor = 0.0f;
+
+            Color vignetted = color_create(
+                color.r * factor,
+                color.g * factor,
+                color.b * factor
+            );
+
+            image_set_pixel(image, x, y, vignetted);
+        }
+    }
+}
+
+// Вспомогательная функция виньетирования. image может быть частью
+// изображения full_width x full_height с левым верхним углом (x_offset, y_offset).
+void apply_vignette(Image* image, float intensity, int x_offset, int y_offset,
+                    int full_width, int full_height) {
+    if (!image || !image_promote_float(image)) {
+        return;
+    }
+
+    VignetteContext context;
+    context.image = image;
+    context.intensity = intensity;
+    context.x_offset = x_offset;
+    context.y_offset = y_offset;
+    context.center_x = full_width / 2.0f;
+    context.center_y = full_height / 2.0f;
+    context.max_distance = sqrtf(context.center_x * context.center_x +
+                                 context.center_y * context.center_y);
+
+    if (context.max_distance < 1.0f) context.max_distance = 1.0f;
+
+    parallel_for_rows(image->height, vignette_rows, &context);
+}
+
+static bool format_is_integer(PixelFormat format) {
+    return format == PIXEL_FORMAT_U8 || format == PIXEL_FORMAT_U16;
+}
+
+// Формат хранения после шага: сепия всегда переводит изображение в PLANAR,
+// виньетка - только целочисленные форматы
+static PixelFormat pointwise_step_format(PixelFormat format, PointwiseOp op) {
+    if (op == POINTWISE_SEPIA || (op == POINTWISE_VIGNETTE && format_is_integer(format))) {
+        return PIXEL_FORMAT_PLANAR;
+    }
+    return format;
+}
+
+typedef struct {
+    Image* image;
+    Image* output;
+    const PointwiseStep* steps;
+    int count;
+    int x_offset;
+    int y_offset;
+    float center_x;
+    float center_y;
+    float max_distance;
+} PointwiseContext;
+
+// Загрузка строки в каналы r, g, b. Целочисленные форматы загружаются
+// без нормирования, как их обрабатывают grayscale и negative.
+static void pointwise_load_row(const Image* image, int y, float* r, float* g, float* b) {
+    int width = image->width;
+
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        memcpy(r, image_plane_row(image, 0, y), sizeof(float) * width);
+        memcpy(g, image_plane_row(image, 1, y), sizeof(float) * width);
+        memcpy(b, image_plane_row(image, 2, y), sizeof(float) * width);
+    } else if (image->format == PIXEL_FORMAT_U8) {
+        const Color8* pixels = (const Color8*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            r[x] = pixels[x].r;
+            g[x] = pixels[x].g;
+            b[x] = pixels[x].b;
+        }
+    } else if (image->format == PIXEL_FORMAT_U16) {
+        const Color16* pixels = (const Color16*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            r[x] = pixels[x].r;
+            g[x] = pixels[x].g;
+            b[x] = pixels[x].b;
+        }
+    } else {
+        const Color* pixels = (const Color*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            r[x] = pixels[x].r;
+            g[x] = pixels[x].g;
+            b[x] = pixels[x].b;
+        }
+    }
+}
+
+static void pointwise_store_row(Image* image, int y, const float* r, const float* g, const float* b) {
+    int width = image->width;
+
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        memcpy(image_plane_row(image, 0, y), r, sizeof(float) * width);
+        memcpy(image_plane_row(image, 1, y), g, sizeof(float) * width);
+        memcpy(image_plane_row(image, 2, y), b, sizeof(float) * width);
+    } else if (image->format == PIXEL_FORMAT_U8) {
+        Color8* pixels = (Color8*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            pixels[x].r = (uint8_t)r[x];
+            pixels[x].g = (uint8_t)g[x];
+            pixels[x].b = (uint8_t)b[x];
+        }
+    } else if (image->format == PIXEL_FORMAT_U16) {
+        Color16* pixels = (Color16*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            pixels[x].r = (uint16_t)r[x];
+            pixels[x].g = (uint16_t)g[x];
+            pixels[x].b = (uint16_t)b[x];
+        }
+    } else {
+        Color* pixels = (Color*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            pixels[x] = color_create(r[x], g[x], b[x]);
+        }
+    }
+}
+
+// Один шаг цепочки над строкой в формате format
+static void pointwise_step_row(const PointwiseContext* ctx, const PointwiseStep* step,
+                               PixelFormat format, int y, int width,
+                               float* restrict r, float* restrict g, float* restrict b) {
+    switch (step->op) {
+        case POINTWISE_GRAYSCALE:
+            // Целочисленные форматы округляют яркость так же, как grayscale_rows
+            if (format == PIXEL_FORMAT_U8) {
+                for (int x = 0; x < width; x++) {
+                    r[x] = g[x] = b[x] = (uint8_t)(0.299f * r[x] + 0.587f * g[x] + 0.114f * b[x] + 0.5f);
+                }
+            } else if (format == PIXEL_FORMAT_U16) {
+                for (int x = 0; x < width; x++) {
+                    r[x] = g[x] = b[x] = (uint16_t)(0.299f * r[x] + 0.587f * g[x] + 0.114f * b[x] + 0.5f);
+                }
+            } else {
+                for (int x = 0; x < width; x++) {
+                    r[x] = g[x] = b[x] = clamp01(0.299f * r[x] + 0.587f * g[x] + 0.114f * b[x]);
+                }
+            }
+            break;
+
+        case POINTWISE_NEGATIVE: {
+            if (format_is_integer(format)) {
+                float max = (float)pixel_format_max(format);
+                for (int x = 0; x < width; x++) {
+                    r[x] = max - r[x];
+                    g[x] = max - g[x];
+                    b[x] = max - b[x];
+                }
+            } else {
+                for (int x = 0; x < width; x++) {
+                    r[x] = clamp01(1.0f - r[x]);
+                    g[x] = clamp01(1.0f - g[x]);
+                    b[x] = clamp01(1.0f - b[x]);
+                }
+            }
+            break;
+        }
+
+        case POINTWISE_SEPIA:
+            for (int x = 0; x < width; x++) {
+                sepia_pixel(&r[x], &g[x], &b[x]);
+            }
+            break;
+
+        case POINTWISE_VIGNETTE: {
+            // Те же вычисления, что в vignette_rows
+            float dy = y + ctx->y_offset - ctx->center_y;
+            for (int x = 0; x < width; x++) {
+                float dx = x + ctx->x_offset - ctx->center_x;
+                float distance = sqrtf(dx * dx + dy * dy);
+                float factor = 1.0f - (distance / ctx->max_distance) * step->intensity;
+
+                if (factor < 0.0f) factor = 0.0f;
+
+                r[x] = clamp01(r[x] * factor);
+                g[x] = clamp01(g[x] * factor);
+                b[x] = clamp01(b[x] * factor);
+            }
+            break;
+        }
+    }
+}
+
+// Шаги steps[0..count) над строкой шириной width в формате format.
+// Возвращает формат хранения после последнего шага.
+static PixelFormat pointwise_steps_row(const PointwiseContext* ctx, const PointwiseStep* steps,
+                                       int count, PixelFormat format, int y, int width,
+                                       float* r, float* g, float* b) {
+    for (int i = 0; i < count; i++) {
+        PixelFormat next = pointwise_step_format(format, steps[i].op);
+
+        // Смена формата, как в image_convert: нормирование и ограничение
+        if (next != format) {
+            float max = format_is_integer(format) ? (float)pixel_format_max(format) : 1.0f;
+            for (int x = 0; x < width; x++) {
+                r[x] = clamp01(r[x] / max);
+                g[x] = clamp01(g[x] / max);
+                b[x] = clamp01(b[x] / max);
+            }
+            format = next;
+        }
+
+        pointwise_step_row(ctx, &steps[i], format, y, width, r, g, b);
+    }
+
+    return format;
+}
+
+// Строки [y_begin, y_end) слитого прохода: строка проходит все шаги, оставаясь в кэше L1
+static void pointwise_rows(void* context, int y_begin, int y_end) {
+    PointwiseContext* ctx = (PointwiseContext*)context;
+    int width = ctx->image->width;
+
+    float* buffer = (float*)malloc(sizeof(float) * 3 * width);
+    if (!buffer) {
+        fprintf(stderr, "Error: Memory allocation failed for pointwise filters\n");
+        return;
+    }
+
+    float* r = buffer;
+    float* g = buffer + width;
+    float* b = buffer + 2 * width;
+
+    for (int y = y_begin; y < y_end; y++) {
+        pointwise_load_row(ctx->image, y, r, g, b);
+        pointwise_steps_row(ctx, ctx->steps, ctx->count, ctx->image->format, y, width, r, g, b);
+        pointwise_store_row(ctx->output, y, r, g, b);
+    }
+
+    free(buffer);
+}
+
+// Цепочка без виньетки, скомпилированная в таблицы для изображения U8.
+// Негативы до первого grayscale - поканальные таблицы channel. Если в
+// цепочке есть grayscale, пиксель после него определяется одной яркостью:
+// weight - вклады каналов в нее, table - результат остальных шагов для
+// каждой яркости. Иначе table - поканальный результат.
+typedef struct {
+    Image* image;
+    Image* output;
+    bool gray;
+    float weight[3][256];
+    float table[3][256];
+} PointwiseLut;
+
+static bool pointwise_compile_lut(PointwiseLut* lut, const PointwiseContext* ctx) {
+    const PointwiseStep* steps = ctx->steps;
+    int count = ctx->count;
+
+    for (int i = 0; i < count; i++) {
+        if (steps[i].op == POINTWISE_VIGNETTE) {
+            return false;
+        }
+    }
+
+    uint8_t channel[3][256];
+    for (int c = 0; c < 3; c++) {
+        for (int v = 0; v < 256; v++) {
+            channel[c][v] = (uint8_t)v;
+        }
+    }
+
+    int first = 0;
+    while (first < count && steps[first].op == POINTWISE_NEGATIVE) {
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) {
+                channel[c][v] = 255 - channel[c][v];
+            }
+        }
+        first++;
+    }
+
+    lut->gray = first < count && steps[first].op == POINTWISE_GRAYSCALE;
+
+    if (first == count) {
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) {
+                lut->table[c][v] = channel[c][v];
+            }
+        }
+        return true;
+    }
+
+    // Без grayscale результат сепии зависит от всех трех каналов сразу
+    if (!lut->gray) {
+        return false;
+    }
+
+    // Те же произведения, что в grayscale_rows: сумма вкладов совпадает побитно
+    static const float weights[3] = {0.299f, 0.587f, 0.114f};
+    for (int c = 0; c < 3; c++) {
+        for (int v = 0; v < 256; v++) {
+            lut->weight[c][v] = weights[c] * channel[c][v];
+            lut->table[c][v] = (float)v;
+        }
+    }
+
+    // Остальные шаги - над строкой из всех 256 значений яркости
+    pointwise_steps_row(ctx, steps + first + 1, count - first - 1, PIXEL_FORMAT_U8, 0, 256,
+                        lut->table[0], lut->table[1], lut->table[2]);
+    return true;
+}
+
+// Строки [y_begin, y_end) применения таблиц
+static void pointwise_lut_rows(void* context, int y_begin, int y_end) {
+    PointwiseLut* lut = (PointwiseLut*)context;
+    const Image* image = lut->image;
+    Image* output = lut->output;
+
+    for (int y = y_begin; y < y_end; y++) {
+        const Color8* src = (const Color8*)image->data + (size_t)image->stride * y;
+
+        if (output->format == PIXEL_FORMAT_U8) {
+            Color8* dst = (Color8*)output->data + (size_t)output->stride * y;
+            for (int x = 0; x < image->width; x++) {
+                Color8 c = src[x];
+                if (lut->gray) {
+                    uint8_t l = (uint8_t)(lut->weight[0][c.r] + lut->weight[1][c.g] +
+                                          lut->weight[2][c.b] + 0.5f);
+                    c.r = c.g = c.b = l;
+                }
+                dst[x].r = (uint8_t)lut->table[0][c.r];
+                dst[x].g = (uint8_t)lut->table[1][c.g];
+                dst[x].b = (uint8_t)lut->table[2][c.b];
+            }
+        } else {
+            float* restrict r = image_plane_row(output, 0, y);
+            float* restrict g = image_plane_row(output, 1, y);
+            float* restrict b = image_plane_row(output, 2, y);
+            for (int x = 0; x < image->width; x++) {
+                Color8 c = src[x];
+                uint8_t l = (uint8_t)(lut->weight[0][c.r] + lut->weight[1][c.g] +
+                                      lut->weight[2][c.b] + 0.5f);
+                r[x] = lut->table[0][l];
+                g[x] = lut->table[1][l];
+                b[x] = lut->table[2][l];
+            }
+        }
+    }
+}
+
+void apply_pointwise_chain(Image* image, const PointwiseStep* steps, int count,
+                           int x_offset, int y_offset, int full_width, int full_height) {
+    if (!image || !steps || count <= 0) {
+        return;
+    }
+
+    PixelFormat format = image->format;
+    for (int i = 0; i < count; i++) {
+        format = pointwise_step_format(format, steps[i].op);
+    }
+
+    // Смена формата требует нового буфера, иначе строки пишутся на место
+    Image* output = image;
+    if (format != image->format) {
+        output = image_create_format(image->width, image->height, format);
+        if (!output) {
+            fprintf(stderr, "Error: Cannot create image for pointwise filters\n");
+            return;
+        }
+    }
+
+    PointwiseContext context;
+    context.image = image;
+    context.output = output;
+    context.steps = steps;
+    context.count = count;
+    context.x_offset = x_offset;
+    context.y_offset = y_offset;
+    context.center_x = full_width / 2.0f;
+    context.center_y = full_height / 2.0f;
+    context.max_distance = sqrtf(context.center_x * context.center_x +
+                                 context.center_y * context.center_y);
+
+    if (context.max_distance < 1.0f) context.max_distance = 1.0f;
+
+    // Изображение U8 и цепочка без виньетки: поиск в таблицах вместо вычислений
+    PointwiseLut* lut = NULL;
+    if (image->format == PIXEL_FORMAT_U8) {
+        lut = (PointwiseLut*)malloc(sizeof(PointwiseLut));
+        if (lut && !pointwise_compile_lut(lut, &context)) {
+            free(lut);
+            lut = NULL;
+        }
+    }
+
+    if (lut) {
+        lut->image = image;
+        lut->output = output;
+        parallel_for_rows(image->height, pointwise_lut_rows, lut);
+        free(lut);
+    } else {
+        parallel_for_rows(image->height, pointwise_rows, &context);
+    }
+
+    if (output != image) {
+        image_take(image, output);
+    }
+}
+
+// Значение матричного фильтра 3x3 в точке x
+static float matrix_pixel(const float* rows[3], float kernel[3][3], int x) {
+    float sum = 0.0f;
+
+    for (int ky = 0; ky < 3; ky++) {
+        for (int kx = -1; kx <= 1; kx++) {
+            sum += rows[ky][x + kx] * kernel[ky][kx + 1];
+        }
+    }
+
+    return sum;
+}
+
+// Строка матричного фильтра 3x3 для одной плоскости. Строки rows дополнены
+// ореолом, поэтому соседи читаются без ветвлений и у краев.
+static void matrix_row(float* restrict dst, const float* rows[3], float kernel[3][3],
+                       float scale, int width) {
+    int x = 0;
+
+    for (; x + SIMD_LANES <= width; x += SIMD_LANES) {
+        float acc[SIMD_LANES] = {0};
+
+        for (int ky = 0; ky < 3; ky++) {
+            for (int kx = 0; kx < 3; kx++) {
+                const float* src = rows[ky] + x + kx - 1;
+                float weight = kernel[ky][kx];
+
+                for (int l = 0; l < SIMD_LANES; l++) {
+                    acc[l] += src[l] * weight;
+                }
+            }
+        }
+
+        for (int l = 0; l < SIMD_LANES; l++) {
+            dst[x + l] = clamp01(acc[l] * scale);
+        }
+    }
+
+    // Остаток строки
+    for (; x < width; x++) {
+        dst[x] = clamp01(matrix_pixel(rows, kernel, x) * scale);
+    }
+}
+
+typedef struct {
+    Image* image;
+    const Image* temp;   // Копия исходного изображения с ореолом 1
+    float (*kernel)[3];
+    float scale;
+} MatrixContext;
+
+// Строки [y_begin, y_end) матричного фильтра 3x3 во всех плоскостях
+static void matrix_rows(void* context, int y_begin, int y_end) {
+    MatrixContext* ctx = (MatrixContext*)context;
+    Image* image = ctx->image;
+
+    for (int c = 0; c < 3; c++) {
+        for (int y = y_begin; y < y_end; y++) {
+            const float* rows[3] = {
+                image_plane_row(ctx->temp, c, y - 1),
+                image_plane_row(ctx->temp, c, y),
+                image_plane_row(ctx->temp, c, y + 1)
+            };
+
+            matrix_row(image_plane_row(image, c, y), rows, ctx->kernel, ctx->scale, image->width);
+        }
+    }
+}
+
+// Ненулевой вес ядра свертки: смещение столбца и номер строки окна
+typedef struct {
+    int dx;
+    int row;             // Строка окна: смещение строки + radius_y
+} ConvTap;
+
+typedef struct {
+    Image* image;        // Результат
+    const Image* source;
+    const ConvTap* taps;
+    const float* weights;
+    int count;
+    int radius_x;
+    int radius_y;
+    float scale;
+    bool clamp;          // Ограничивать результат диапазоном [0, 1]
+    Border border;       // Продолжение строк источника без ореола
+    atomic_bool failed;  // Участку не хватило памяти, его строки не заполнены
+} ConvContext;
+
+static inline float conv_result(float value, float scale, bool clamp) {
+    return clamp ? clamp01(value * scale) : value * scale;
+}
+
+// Строка свертки одной плоскости; sources[t] - строка окна веса t с ореолом,
+// сдвинутая на его смещение, так что соседи читаются без ветвлений
+static void conv_row(float* restrict dst, const float* const* sources, const ConvContext* ctx,
+                     int width) {
+    int x = 0;
+
+    for (; x + SIMD_LANES <= width; x += SIMD_LANES) {
+        float acc[SIMD_LANES] = {0};
+
+        for (int t = 0; t < ctx->count; t++) {
+            const float* src = sources[t] + x;
+            float weight = ctx->weights[t];
+
+            for (int l = 0; l < SIMD_LANES; l++) {
+                acc[l] += src[l] * weight;
+            }
+        }
+
+        for (int l = 0; l < SIMD_LANES; l++) {
+            dst[x + l] = conv_result(acc[l], ctx->scale, ctx->clamp);
+        }
+    }
+
+    // Остаток строки
+    for (; x < width; x++) {
+        float sum = 0.0f;
+        for (int t = 0; t < ctx->count; t++) {
+            sum += sources[t][x] * ctx->weights[t];
+        }
+        dst[x] = conv_result(sum, ctx->scale, ctx->clamp);
+    }
+}
+
+// Строки [y_begin, y_end) свертки source -> image во всех плоскостях.
+// Источник с ореолом читается напрямую; источник без ореола (только для
+// radius_y = 0) дополняется по одной строке в буфер line. Указатели весов
+// одномерного ядра хранятся на стеке, так что проход по источнику с
+// ореолом и не больше CONV_MAX_SIZE весами не выделяет память.
+static void conv_rows(void* context, int y_begin, int y_end) {
+    ConvContext* ctx = (ConvContext*)context;
+    int width = ctx->image->width;
+    int radius = ctx->radius_x;
+    bool pad_rows = ctx->source->halo < radius;
+    const float* rows[CONV_MAX_SIZE];
+    const float* row_sources[CONV_MAX_SIZE];
+
+    const float** sources = ctx->count <= CONV_MAX_SIZE ? row_sources :
+                            (const float**)malloc(sizeof(float*) * ctx->count);
+    float* line = pad_rows ? (float*)malloc(sizeof(float) * (width + 2 * radius)) : NULL;
+    if (!sources || (pad_rows && !line)) {
+        if (sources != row_sources) {
+            free(sources);
+        }
+        free(line);
+        fprintf(stderr, "Error: Memory allocation failed for convolution\n");
+        atomic_store(&ctx->failed, true);
+        return;
+    }
+
+    for (int c = 0; c < 3; c++) {
+        for (int y = y_begin; y < y_end; y++) {
+            if (pad_rows) {
+                memcpy(line + radius, image_plane_row(ctx->source, c, y), sizeof(float) * width);
+                border_fill_row(line + radius, width, radius, ctx->border);
+                rows[0] = line + radius;
+            } else {
+                for (int i = 0; i <= 2 * ctx->radius_y; i++) {
+                    rows[i] = image_plane_row(ctx->source, c, y + i - ctx->radius_y);
+                }
+            }
+
+            for (int t = 0; t < ctx->count; t++) {
+                sources[t] = rows[ctx->taps[t].row] + ctx->taps[t].dx;
+            }
+
+            conv_row(image_plane_row(ctx->image, c, y), sources, ctx, width);
+        }
+    }
+
+    if (sources != row_sources) {
+        free(sources);
+    }
+    free(line);
+}
+
+// Ненулевые веса ядра в порядке строк; возвращает их число
+static int conv_taps(const float* kernel, int width, int height, ConvTap* taps, float* weights) {
+    int count = 0;
+
+    for (int ky = 0; ky < height; ky++) {
+        for (int kx = 0; kx < width; kx++) {
+            float weight = kernel[ky * width + kx];
+            if (weight != 0.0f) {
+                taps[count].dx = kx - width / 2;
+                taps[count].row = ky;
+                weights[count] = weight;
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+// Разложение ядра ранга 1 в произведение столбца column и строки row
+static bool conv_separate(const float* kernel, int width, int height, float* column, float* row) {
+    int pivot = 0;
+    for (int i = 1; i < width * height; i++) {
+        if (fabsf(kernel[i]) > fabsf(kernel[pivot])) {
+            pivot = i;
+        }
+    }
+
+    float peak = kernel[pivot];
+    if (peak == 0.0f || width == 1 || height == 1) {
+        return false;
+    }
+
+    int py = pivot / width;
+    int px = pivot % width;
+    for (int kx = 0; kx < width; kx++) {
+        row[kx] = kernel[py * width + kx];
+    }
+    for (int ky = 0; ky < height; ky++) {
+        column[ky] = kernel[ky * width + px] / peak;
+    }
+
+    float tolerance = fabsf(peak) * 1e-6f;
+    for (int ky = 0; ky < height; ky++) {
+        for (int kx = 0; kx < width; kx++) {
+            if (fabsf(kernel[ky * width + kx] - column[ky] * row[kx]) > tolerance) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool apply_convolution(Image* image, const float* kernel, int width, int height, float divisor) {
+    if (!image || !kernel || width < 1 || height < 1 || width % 2 == 0 || height % 2 == 0 ||
+        width > CONV_MAX_SIZE || height > CONV_MAX_SIZE) {
+        fprintf(stderr, "Error: Convolution kernel must have odd size up to %d\n", CONV_MAX_SIZE);
+        return false;
+    }
+
+    if (!image_convert(image, PIXEL_FORMAT_PLANAR)) {
+        return false;
+    }
+
+    // Нормирующий множитель одинаков для всех пикселей
+    float total_weight = 0.0f;
+    for (int i = 0; i < width * height; i++) {
+        total_weight += kernel[i];
+    }
+
+    float scale = 1.0f;
+    if (divisor != 0) {
+        scale = 1.0f / divisor;
+    } else if (total_weight != 0) {
+        scale = 1.0f / total_weight;
+    }
+
+    int capacity = width * height + width + height;
+    ConvTap* taps = (ConvTap*)malloc(sizeof(ConvTap) * capacity);
+    float* weights = (float*)malloc(sizeof(float) * capacity);
+    if (!taps || !weights) {
+        free(taps);
+        free(weights);
+        fprintf(stderr, "Error: Memory allocation failed for convolution kernel\n");
+        return false;
+    }
+
+    ConvContext context;
+    context.image = image;
+    context.scale = scale;
+    context.clamp = true;
+    context.border = filters_border;
+    atomic_init(&context.failed, false);
+
+    float column[CONV_MAX_SIZE];
+    float row[CONV_MAX_SIZE];
+    bool success = false;
+
+    if (conv_separate(kernel, width, height, column, row)) {
+        // Ранг 1: строки сворачиваются с row в temp без ограничения значений,
+        // затем столбцы temp (с ореолом по вертикали) - с column обратно в image
+        Image* temp = image_create_padded(image->width, image->height, height / 2);
+        if (temp) {
+            int row_count = conv_taps(row, width, 1, taps, weights);
+            int column_count = conv_taps(column, 1, height, taps + width, weights + width);
+
+            context.source = image;
+            context.image = temp;
+            context.taps = taps;
+            context.weights = weights;
+            context.count = row_count;
+            context.radius_x = width / 2;
+            context.radius_y = 0;
+            context.scale = 1.0f;
+            context.clamp = false;
+            parallel_for_rows(image->height, conv_rows, &context);
+
+            // Второй проход пишет в image, поэтому выполняется только по полному temp
+            if (atomic_load(&context.failed)) {
+                image_destroy(temp);
+                free(taps);
+                free(weights);
+                return false;
+            }
+
+            // За верхним и нижним краями temp - строки постоянных значений, свернутые с row
+            float row_sum = 0.0f;
+            for (int kx = 0; kx < width; kx++) {
+                row_sum += row[kx];
+            }
+
+            Border border = context.border;
+            border.value *= row_sum;
+            image_fill_halo(temp, border);
+
+            context.source = temp;
+            context.image = image;
+            context.taps = taps + width;
+            context.weights = weights + width;
+            context.count = column_count;
+            context.radius_x = 0;
+            context.radius_y = height / 2;
+            context.scale = scale;
+            context.clamp = true;
+            parallel_for_rows(image->height, conv_rows, &context);
+
+            image_destroy(temp);
+            success = !atomic_load(&context.failed);
+        }
+    } else if (width == 3 && height == 3) {
+        // Ядра 3x3 (резкость, тиснение) - развернутым циклом по всем весам
+        Image* temp = image_pad(image, 1, context.border);
+        if (temp) {
+            MatrixContext matrix = {image, temp, (float (*)[3])kernel, scale};
+            parallel_for_rows(image->height, matrix_rows, &matrix);
+
+            image_destroy(temp);
+            success = true;
+        }
+    } else {
+        int halo = width > height ? width / 2 : height / 2;
+        Image* temp = image_pad(image, halo, context.border);
+        if (temp) {
+            context.source = temp;
+            context.taps = taps;
+            context.weights = weights;
+            context.count = conv_taps(kernel, width, height, taps, weights);
+            context.radius_x = width / 2;
+            context.radius_y = height / 2;
+            parallel_for_rows(image->height, conv_rows, &context);
+
+            // temp - копия входа: строки участков без памяти возвращаются к исходным
+            success = !atomic_load(&context.failed);
+            if (!success) {
+                image_copy_region(image, 0, 0, temp, 0, 0, image->width, image->height);
+            }
+
+            image_destroy(temp);
+        }
+    }
+
+    free(taps);
+    free(weights);
+    return success;
+}
+
+// Вспомогательная функция для применения матричного фильтра
+void apply_matrix_filter(Image* image, float kernel[3][3], float divisor) {
+    apply_convolution(image, &kernel[0][0], 3, 3, divisor);
+}
+
+// Convolution filter
+void filter_convolution(Image* image, void* params) {
+    if (!image || !params) {
+        fprintf(stderr, "Error: filter_convolution received NULL parameters\n");
+        return;
+    }
+
+    ConvParams* conv = (ConvParams*)params;
+    filter_log("Applying %dx%d convolution\n", conv->width, conv->height);
+    apply_convolution(image, conv->weights, conv->width, conv->height, conv->divisor);
+}
+
+// Горизонтальная свертка одной строки плоскости; src дополнена ореолом radius
+static void blur_row(float* restrict dst, const float* restrict src,
+                     const float* kernel, int radius, int width) {
+    int x = 0;
+
+    for (; x + SIMD_LANES <= width; x += SIMD_LANES) {
+        float acc[SIMD_LANES] = {0};
+
+        for (int k = -radius; k <= radius; k++) {
+            const float* p = src + x + k;
+            float weight = kernel[k + radius];
+
+            for (int l = 0; l < SIMD_LANES; l++) {
+                acc[l] += p[l] * weight;
+            }
+        }
+
+        for (int l = 0; l < SIMD_LANES; l++) {
+            dst[x + l] = clamp01(acc[l]);
+        }
+    }
+
+    // Остаток строки
+    for (; x < width; x++) {
+        float sum = 0.0f;
+        for (int k = -radius; k <= radius; k++) {
+            sum += src[x + k] * kernel[k + radius];
+        }
+        dst[x] = clamp01(sum);
+    }
+}
+
+// Вертикальная свертка lanes (не более SIMD_LANES) соседних столбцов плоскости;
+// строки temp за краями берутся из ореола
+static inline void blur_columns(float* restrict dst, const Image* temp, int c, int x, int y,
+                                const float* kernel, int radius, int lanes) {
+    float acc[SIMD_LANES] = {0};
+
+    for (int k = -radius; k <= radius; k++) {
+        const float* src = image_plane_row(temp, c, y + k) + x;
+        float weight = kernel[k + radius];
+
+        for (int l = 0; l < lanes; l++) {
+            acc[l] += src[l] * weight;
+        }
+    }
+
+    for (int l = 0; l < lanes; l++) {
+        dst[l] = clamp01(acc[l]);
+    }
+}
+
+typedef struct {
+    Image* image;
+    Image* temp;         // Результат горизонтального прохода с ореолом radius
+    const float* kernel;
+    int radius;
+    int planes;          // Размываемых плоскостей, начиная с первой
+    Border border;
+    atomic_bool failed;  // Участку не хватило памяти, его строки temp не заполнены
+} BlurContext;
+
+// Строки [y_begin, y_end) горизонтального размытия: image -> temp.
+// Строка image дополняется ореолом в буфере line.
+static void blur_horizontal_rows(void* context, int y_begin, int y_end) {
+    BlurContext* ctx = (BlurContext*)context;
+    int width = ctx->image->width;
+    int radius = ctx->radius;
+
+    float* line = (float*)malloc(sizeof(float) * (width + 2 * radius));
+    if (!line) {
+        fprintf(stderr, "Error: Memory allocation failed for Gaussian blur\n");
+        atomic_store(&ctx->failed, true);
+        return;
+    }
+
+    for (int c = 0; c < ctx->planes; c++) {
+        for (int y = y_begin; y < y_end; y++) {
+            memcpy(line + radius, image_plane_row(ctx->image, c, y), sizeof(float) * width);
+            border_fill_row(line + radius, width, radius, ctx->border);
+            blur_row(image_plane_row(ctx->temp, c, y), line + radius, ctx->kernel, radius, width);
+        }
+    }
+
+    free(line);
+}
+
+// Строки [y_begin, y_end) вертикального размытия: temp -> image,
+// блоками по SIMD_LANES столбцов, затем остаток строки
+static void blur_vertical_rows(void* context, int y_begin, int y_end) {
+    BlurContext* ctx = (BlurContext*)context;
+    int width = ctx->image->width;
+
+    for (int c = 0; c < ctx->planes; c++) {
+        for (int y = y_begin; y < y_end; y++) {
+            float* dst = image_plane_row(ctx->image, c, y);
+            int x = 0;
+
+            for (; x + SIMD_LANES <= width; x += SIMD_LANES) {
+                blur_columns(dst + x, ctx->temp, c, x, y, ctx->kernel, ctx->radius, SIMD_LANES);
+            }
+
+            if (x < width) {
+                blur_columns(dst + x, ctx->temp, c, x, y, ctx->kernel, ctx->radius, width - x);
+            }
+        }
+    }
+}
+
+// Рекурсивный гауссов фильтр (Young, van Vliet, 1995): прямой и обратный
+// проходы y[n] = b * x[n] + a1 * y[n-1] + a2 * y[n-2] + a3 * y[n-3].
+// Стоимость на пиксель не зависит от sigma.
+typedef struct {
+    double b;
+    double a[3];
+    double m[3][3];   // Начальные значения обратного прохода у правого края
+} RecursiveGaussian;
+
+static void recursive_gaussian_init(RecursiveGaussian* g, float sigma) {
+    double q = sigma >= 2.5f ? 0.98711 * sigma - 0.96330 :
+                               3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    g->a[0] = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    g->a[1] = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    g->a[2] = 0.422205 * q3 / b0;
+    g->b = 1.0 - (g->a[0] + g->a[1] + g->a[2]);
+
+    // Правый край продолжается крайним значением u (как у ядра с ограничением
+    // индексов). Начальные значения обратного прохода линейно зависят от
+    // отклонений w[n-1-j] - u последних значений прямого прохода (Triggs,
+    // Sdika, 2006); матрица находится прогоном фильтра для каждого отклонения.
+    int length = (int)ceil(10 * sigma) + 32;
+    double* w = (double*)malloc(sizeof(double) * (length + 3));
+
+    for (int j = 0; j < 3; j++) {
+        if (!w) {
+            g->m[0][j] = g->m[1][j] = g->m[2][j] = 0.0;
+            continue;
+        }
+
+        // w[0..2] - отклонения последних значений прямого прохода
+        w[0] = w[1] = w[2] = 0.0;
+        w[2 - j] = 1.0;
+        for (int n = 3; n < length + 3; n++) {
+            w[n] = g->a[0] * w[n - 1] + g->a[1] * w[n - 2] + g->a[2] * w[n - 3];
+        }
+
+        double y1 = 0.0, y2 = 0.0, y3 = 0.0;
+        for (int n = length + 2; n >= 3; n--) {
+            double y = g->b * w[n] + g->a[0] * y1 + g->a[1] * y2 + g->a[2] * y3;
+            y3 = y2;
+            y2 = y1;
+            y1 = y;
+            if (n <= 5) {
+                g->m[n - 3][j] = y;
+            }
+        }
+    }
+
+    free(w);
+}
+
+typedef struct {
+    Image* image;
+    RecursiveGaussian g;
+    int planes;
+} RecursiveBlurContext;
+
+// Строк, обрабатываемых горизонтальным проходом одновременно: рекурсия
+// вдоль строки последовательна, но строки группы независимы
+#define RECURSIVE_BLUR_ROWS SIMD_LANES
+
+// Строки [y_begin, y_end) горизонтального рекурсивного размытия (на месте)
+static void recursive_blur_rows(void* context, int y_begin, int y_end) {
+    RecursiveBlurContext* ctx = (RecursiveBlurContext*)context;
+    const RecursiveGaussian* g = &ctx->g;
+    int width = ctx->image->width;
+    enum { L = RECURSIVE_BLUR_ROWS };
+
+    double* w = (double*)malloc(sizeof(double) * L * width);
+    if (!w) {
+        fprintf(stderr, "Error: Memory allocation failed for Gaussian blur\n");
+        return;
+    }
+
+    for (int c = 0; c < ctx->planes; c++) {
+        for (int y0 = y_begin; y0 < y_end; y0 += L) {
+            // Недостающие строки последней группы повторяют ее первую строку
+            float* rows[L];
+            for (int l = 0; l < L; l++) {
+                rows[l] = image_plane_row(ctx->image, c, y0 + l < y_end ? y0 + l : y0);
+            }
+
+            // Левый край продолжается крайним значением: установившийся режим
+            double w1[L], w2[L], w3[L];
+            for (int l = 0; l < L; l++) {
+                w1[l] = w2[l] = w3[l] = rows[l][0];
+            }
+
+            for (int x = 0; x < width; x++) {
+                for (int l = 0; l < L; l++) {
+                    double value = g->b * rows[l][x] + g->a[0] * w1[l] + g->a[1] * w2[l] + g->a[2] * w3[l];
+                    w3[l] = w2[l];
+                    w2[l] = w1[l];
+                    w1[l] = value;
+                    w[(size_t)x * L + l] = value;
+                }
+            }
+
+            double y1[L], y2[L], y3[L];
+            for (int l = 0; l < L; l++) {
+                double u = rows[l][width - 1];
+                double d[3];
+                for (int j = 0; j < 3; j++) {
+                    d[j] = w[(size_t)(width - 1 - j >= 0 ? width - 1 - j : 0) * L + l] - u;
+                }
+                y1[l] = u + g->m[0][0] * d[0] + g->m[0][1] * d[1] + g->m[0][2] * d[2];
+                y2[l] = u + g->m[1][0] * d[0] + g->m[1][1] * d[1] + g->m[1][2] * d[2];
+                y3[l] = u + g->m[2][0] * d[0] + g->m[2][1] * d[1] + g->m[2][2] * d[2];
+            }
+
+            // Обратный проход пишет результат на место; повторенные строки
+            // получают то же значение, что и их первая строка
+            for (int x = width - 1; x >= 0; x--) {
+                double out[L];
+                for (int l = 0; l < L; l++) {
+                    double value = g->b * w[(size_t)x * L + l] + g->a[0] * y1[l] +
+                                   g->a[1] * y2[l] + g->a[2] * y3[l];
+                    y3[l] = y2[l];
+                    y2[l] = y1[l];
+                    y1[l] = value;
+                    out[l] = value;
+                }
+                for (int l = 0; l < L; l++) {
+                    rows[l][x] = (float)out[l];
+                }
+            }
+        }
+    }
+
+    free(w);
+}
+
+// Столбцов в блоке вертикального прохода: рекурсия идет по строкам,
+// а столбцы блока обрабатываются векторно
+#define RECURSIVE_BLUR_COLUMNS (SIMD_LANES * 4)
+
+// Блоки столбцов [block_begin, block_end) вертикального рекурсивного размытия (на месте)
+static void recursive_blur_columns(void* context, int block_begin, int block_end) {
+    RecursiveBlurContext* ctx = (RecursiveBlurContext*)context;
+    const RecursiveGaussian* g = &ctx->g;
+    Image* image = ctx->image;
+    int height = image->height;
+    enum { L = RECURSIVE_BLUR_COLUMNS };
+
+    double* w = (double*)malloc(sizeof(double) * L * height);
+    if (!w) {
+        fprintf(stderr, "Error: Memory allocation failed for Gaussian blur\n");
+        return;
+    }
+
+    for (int block = block_begin; block < block_end; block++) {
+        int x0 = block * L;
+        int lanes = image->width - x0 < L ? image->width - x0 : L;
+
+        for (int c = 0; c < ctx->planes; c++) {
+            double w1[L], w2[L], w3[L];
+            const float* top = image_plane_row(image, c, 0) + x0;
+            for (int l = 0; l < L; l++) {
+                w1[l] = w2[l] = w3[l] = l < lanes ? top[l] : 0.0;
+            }
+
+            for (int y = 0; y < height; y++) {
+                const float* row = image_plane_row(image, c, y) + x0;
+                double x[L];
+                for (int l = 0; l < L; l++) {
+                    x[l] = l < lanes ? row[l] : 0.0;
+                }
+                for (int l = 0; l < L; l++) {
+                    double value = g->b * x[l] + g->a[0] * w1[l] + g->a[1] * w2[l] + g->a[2] * w3[l];
+                    w3[l] = w2[l];
+                    w2[l] = w1[l];
+                    w1[l] = value;
+                    w[(size_t)y * L + l] = value;
+                }
+            }
+
+            const float* bottom = image_plane_row(image, c, height - 1) + x0;
+            double y1[L], y2[L], y3[L];
+            for (int l = 0; l < L; l++) {
+                double u = l < lanes ? bottom[l] : 0.0;
+                double d[3];
+                for (int j = 0; j < 3; j++) {
+                    d[j] = w[(size_t)(height - 1 - j >= 0 ? height - 1 - j : 0) * L + l] - u;
+                }
+                y1[l] = u + g->m[0][0] * d[0] + g->m[0][1] * d[1] + g->m[0][2] * d[2];
+                y2[l] = u + g->m[1][0] * d[0] + g->m[1][1] * d[1] + g->m[1][2] * d[2];
+                y3[l] = u + g->m[2][0] * d[0] + g->m[2][1] * d[1] + g->m[2][2] * d[2];
+            }
+
+            for (int y = height - 1; y >= 0; y--) {
+                float* row = image_plane_row(image, c, y) + x0;
+                double out[L];
+                for (int l = 0; l < L; l++) {
+                    double value = g->b * w[(size_t)y * L + l] + g->a[0] * y1[l] +
+                                   g->a[1] * y2[l] + g->a[2] * y3[l];
+                    y3[l] = y2[l];
+                    y2[l] = y1[l];
+                    y1[l] = value;
+                    out[l] = value;
+                }
+                for (int l = 0; l < lanes; l++) {
+                    row[l] = clamp01((float)out[l]);
+                }
+            }
+        }
+    }
+
+    free(w);
+}
+
+// Рекурсивное размытие: строки, затем блоки столбцов распределяются между потоками
+static void apply_recursive_gaussian_blur(Image* image, float sigma, int planes) {
+    if (!image_convert(image, PIXEL_FORMAT_PLANAR)) {
+        return;
+    }
+
+    RecursiveBlurContext context;
+    context.image = image;
+    context.planes = planes;
+    recursive_gaussian_init(&context.g, sigma);
+
+    int blocks = (image->width + RECURSIVE_BLUR_COLUMNS - 1) / RECURSIVE_BLUR_COLUMNS;
+    parallel_for_rows(image->height, recursive_blur_rows, &context);
+    parallel_for_rows(blocks, recursive_blur_columns, &context);
+}
+
+int gaussian_blur_radius(float sigma) {
+    // Рекурсивный фильтр не финитен; за 5 sigma вклад соседей меньше 1e-6
+    bool recursive = sigma >= BLUR_RECURSIVE_MIN_SIGMA && filters_border.mode == BORDER_CLAMP;
+    return (int)ceil((recursive ? 5 : 3) * sigma);
+}
+
+// Гауссово размытие первых planes плоскостей изображения
+static void gaussian_blur_planes(Image* image, float sigma, int planes) {
+
+    // Для больших sigma ядро длинное, рекурсивный фильтр быстрее. Его начальные
+    // условия у краев выводятся для BORDER_CLAMP, с другими краями нужно ядро.
+    if (sigma >= BLUR_RECURSIVE_MIN_SIGMA && filters_border.mode == BORDER_CLAMP) {
+        apply_recursive_gaussian_blur(image, sigma, planes);
+        return;
+    }
+
+    // Рассчитываем размер ядра (3σ в каждую сторону)
+    int kernel_radius = (int)ceil(3 * sigma);
+    int kernel_size = kernel_radius * 2 + 1;
+
+    float* kernel = (float*)malloc(sizeof(float) * kernel_size);
+    if (!kernel) {
+        fprintf(stderr, "Error: Memory allocation failed for Gaussian kernel\n");
+        return;
+    }
+
+    // Создаем 1D ядро Гаусса
+    float sum = 0.0f;
+    float two_sigma_sq = 2 * sigma * sigma;
+
+    for (int i = 0; i < kernel_size; i++) {
+        int x = i - kernel_radius;
+        kernel[i] = expf(-(x * x) / two_sigma_sq);
+        sum += kernel[i];
+    }
+
+    // Нормализация
+    for (int i = 0; i < kernel_size; i++) {
+        kernel[i] /= sum;
+    }
+
+    if (!image_convert(image, PIXEL_FORMAT_PLANAR)) {
+        free(kernel);
+        return;
+    }
+
+    // Применяем раздельно по горизонтали и вертикали:
+    // горизонтальный проход пишет в temp, вертикальный - обратно в image
+    Image* temp = image_create_padded(image->width, image->height, kernel_radius);
+    if (!temp) {
+        free(kernel);
+        return;
+    }
+
+    BlurContext context;
+    context.image = image;
+    context.temp = temp;
+    context.kernel = kernel;
+    context.radius = kernel_radius;
+    context.planes = planes;
+    context.border = filters_border;
+    atomic_init(&context.failed, false);
+    parallel_for_rows(image->height, blur_horizontal_rows, &context);
+
+    // Вертикальный проход по неполному temp испортил бы изображение: оно не меняется
+    if (!atomic_load(&context.failed)) {
+        image_fill_halo(temp, filters_border);
+        parallel_for_rows(image->height, blur_vertical_rows, &context);
+    }
+
+    image_destroy(temp);
+    free(kernel);
+}
+
+// Вспомогательная функция для гауссова размытия
+void apply_gaussian_blur(Image* image, float sigma) {
+    if (!image || sigma <= 0) {
+        return;
+    }
+
+    gaussian_blur_planes(image, sigma, 3);
+}
+
+// Проход box-фильтра по строкам и столбцам. Расширенный box (Gwosdek и др.,
+// 2011) дополнительно берет соседей на расстоянии radius + 1 с весом outer,
+// что позволяет точно подобрать дисперсию; у обычного box outer = 0.
+typedef struct {
+    int radius;
+    double inner;        // Вес соседей на расстоянии до radius
+    double outer;        // Вес соседей на расстоянии radius + 1
+} BoxKernel;
+
+typedef struct {
+    Image* image;
+    Image* temp;
+    const BoxKernel* kernels;
+    int count;
+    const Image* source;     // Вход и выход текущего вертикального прохода
+    Image* target;
+    const BoxKernel* kernel;
+    atomic_bool failed;      // Участку не хватило памяти, его строки temp не заполнены
+} BoxBlurContext;
+
+// Значение box-фильтра в точке x по сумме окна с ограничением столбцов
+static inline float box_blur_pixel(const float* src, const BoxKernel* kernel,
+                                   double sum, int x, int last) {
+    double edges = (double)src[clamp_index(x - kernel->radius - 1, last)] +
+                   src[clamp_index(x + kernel->radius + 1, last)];
+    return (float)(sum * kernel->inner + edges * kernel->outer);
+}
+
+// Горизонтальный проход одной строки скользящей суммой
+static void box_blur_row(float* restrict dst, const float* restrict src,
+                         const BoxKernel* kernel, int width) {
+    int radius = kernel->radius;
+    int last = width - 1;
+
+    // Окно левого края с ограничением столбцов; сумма в double накапливает
+    // мало ошибок при добавлении и вычитании на всей строке
+    double sum = src[0] * (double)(radius + 1);
+    for (int i = 1; i <= radius; i++) {
+        sum += src[clamp_index(i, last)];
+    }
+
+    int x = 0;
+
+    // Левая граница
+    for (; x <= radius + 1 && x < width; x++) {
+        dst[x] = box_blur_pixel(src, kernel, sum, x, last);
+        sum += (double)src[clamp_index(x + radius + 1, last)] - src[clamp_index(x - radius, last)];
+    }
+
+    // Внутренняя часть без ограничения координат: разность входящего и
+    // уходящего значений не зависит от суммы, цепочка зависимостей короче
+    for (; x + radius + 1 < width; x++) {
+        double edges = (double)src[x - radius - 1] + src[x + radius + 1];
+        dst[x] = (float)(sum * kernel->inner + edges * kernel->outer);
+        sum += (double)src[x + radius + 1] - src[x - radius];
+    }
+
+    // Правая граница
+    for (; x < width; x++) {
+        dst[x] = box_blur_pixel(src, kernel, sum, x, last);
+        sum += (double)src[clamp_index(x + radius + 1, last)] - src[clamp_index(x - radius, last)];
+    }
+}
+
+// Строки [y_begin, y_end) горизонтальных проходов всех фильтров: image -> temp.
+// Промежуточные результаты строки остаются в кэше.
+static void box_blur_horizontal_rows(void* context, int y_begin, int y_end) {
+    BoxBlurContext* ctx = (BoxBlurContext*)context;
+    int width = ctx->image->width;
+
+    float* scratch = (float*)malloc(sizeof(float) * 2 * width);
+    if (!scratch) {
+        fprintf(stderr, "Error: Memory allocation failed for box blur\n");
+        atomic_store(&ctx->failed, true);
+        return;
+    }
+
+    for (int c = 0; c < 3; c++) {
+        for (int y = y_begin; y < y_end; y++) {
+            const float* src = image_plane_row(ctx->image, c, y);
+
+            for (int i = 0; i < ctx->count; i++) {
+                float* dst = i == ctx->count - 1 ? image_plane_row(ctx->temp, c, y) :
+                                                   scratch + (i % 2) * width;
+                box_blur_row(dst, src, &ctx->kernels[i], width);
+                src = dst;
+            }
+        }
+    }
+
+    free(scratch);
+}
+
+// Столбцов в блоке вертикального прохода. Суммы блока идут сверху вниз
+// независимо от разбиения на потоки, поэтому результат от него не зависит;
+// широкий блок читает строки подряд, что удобно для предвыборки.
+#define BOX_BLUR_COLUMNS 256
+
+// Вертикальный шаг для lanes столбцов: выход строки и сдвиг сумм окна вниз,
+// группами по SIMD_LANES столбцов, затем остаток
+static void box_blur_step(float* restrict dst, double* restrict sum,
+                          const float* restrict above, const float* restrict below,
+                          const float* restrict leaving, double inner, double outer, int lanes) {
+    int l = 0;
+
+    for (; l + SIMD_LANES <= lanes; l += SIMD_LANES) {
+        for (int k = 0; k < SIMD_LANES; k++) {
+            double edges = (double)above[l + k] + below[l + k];
+            dst[l + k] = clamp01((float)(sum[l + k] * inner + edges * outer));
+            sum[l + k] += (double)below[l + k] - leaving[l + k];
+        }
+    }
+
+    for (; l < lanes; l++) {
+        double edges = (double)above[l] + below[l];
+        dst[l] = clamp01((float)(sum[l] * inner + edges * outer));
+        sum[l] += (double)below[l] - leaving[l];
+    }
+}
+
+// Вертикальный проход lanes столбцов плоскости c, начиная с x0: source -> target
+static void box_blur_block(BoxBlurContext* ctx, int c, int x0, int lanes) {
+    const Image* source = ctx->source;
+    const BoxKernel* kernel = ctx->kernel;
+    int radius = kernel->radius;
+    int last = source->height - 1;
+    double sum[BOX_BLUR_COLUMNS];
+
+    const float* top = image_plane_row(source, c, 0) + x0;
+    for (int l = 0; l < lanes; l++) {
+        sum[l] = top[l] * (double)(radius + 1);
+    }
+    for (int i = 1; i <= radius; i++) {
+        const float* row = image_plane_row(source, c, clamp_index(i, last)) + x0;
+        for (int l = 0; l < lanes; l++) {
+            sum[l] += row[l];
+        }
+    }
+
+    for (int y = 0; y <= last; y++) {
+        const float* above = image_plane_row(source, c, clamp_index(y - radius - 1, last)) + x0;
+        const float* below = image_plane_row(source, c, clamp_index(y + radius + 1, last)) + x0;
+        const float* leaving = image_plane_row(source, c, clamp_index(y - radius, last)) + x0;
+        box_blur_step(image_plane_row(ctx->target, c, y) + x0, sum, above, below, leaving,
+                      kernel->inner, kernel->outer, lanes);
+    }
+}
+
+// Блоки столбцов [block_begin, block_end) вертикального прохода: source -> target
+static void box_blur_columns(void* context, int block_begin, int block_end) {
+    BoxBlurContext* ctx = (BoxBlurContext*)context;
+    int width = ctx->source->width;
+
+    for (int block = block_begin; block < block_end; block++) {
+        int x0 = block * BOX_BLUR_COLUMNS;
+
+        int lanes = width - x0 < BOX_BLUR_COLUMNS ? width - x0 : BOX_BLUR_COLUMNS;
+
+        for (int c = 0; c < 3; c++) {
+            box_blur_block(ctx, c, x0, lanes);
+        }
+    }
+}
+
+// Последовательные проходы box-фильтров; стоимость не зависит от радиусов
+static void apply_box_kernels(Image* image, const BoxKernel* kernels, int count) {
+    if (!image_convert(image, PIXEL_FORMAT_PLANAR)) {
+        return;
+    }
+
+    Image* temp = image_create_format(image->width, image->height, PIXEL_FORMAT_PLANAR);
+    if (!temp) {
+        return;
+    }
+
+    BoxBlurContext context;
+    context.image = image;
+    context.temp = temp;
+    context.kernels = kernels;
+    context.count = count;
+    atomic_init(&context.failed, false);
+    parallel_for_rows(image->height, box_blur_horizontal_rows, &context);
+
+    // Вертикальные проходы по неполному temp испортили бы изображение: оно не меняется
+    if (atomic_load(&context.failed)) {
+        image_destroy(temp);
+        return;
+    }
+
+    // Вертикальные проходы поочередно переносят результат между temp и image
+    int blocks = (image->width + BOX_BLUR_COLUMNS - 1) / BOX_BLUR_COLUMNS;
+    for (int i = 0; i < count; i++) {
+        context.source = i % 2 == 0 ? temp : image;
+        context.target = i % 2 == 0 ? image : temp;
+        context.kernel = &kernels[i];
+        parallel_for_rows(blocks, box_blur_columns, &context);
+    }
+
+    if (count % 2 == 0) {
+        image_take(image, temp);
+    } else {
+        image_destroy(temp);
+    }
+}
+
+// Расширенные box-фильтры, дисперсия которых в сумме равна sigma^2
+static void box_gaussian_kernels(float sigma, BoxKernel kernels[BLUR_BOX_PASSES]) {
+    double variance = (double)sigma * sigma / BLUR_BOX_PASSES;
+    int radius = (int)floor(0.5 * sqrt(12.0 * variance + 1.0) - 0.5);
+
+    // Вес крайних соседей добирает дисперсию, недостающую box радиуса radius
+    double alpha = (2 * radius + 1) * (radius * (radius + 1) - 3.0 * variance) /
+                   (6.0 * (variance - (radius + 1) * (radius + 1)));
+    double norm = 2.0 * alpha + 2 * radius + 1;
+
+    for (int i = 0; i < BLUR_BOX_PASSES; i++) {
+        kernels[i].radius = radius;
+        kernels[i].inner = 1.0 / norm;
+        kernels[i].outer = alpha / norm;
+    }
+}
+
+int box_gaussian_radius(float sigma) {
+    BoxKernel kernels[BLUR_BOX_PASSES];
+    box_gaussian_kernels(sigma, kernels);
+
+    int radius = 0;
+    for (int i = 0; i < BLUR_BOX_PASSES; i++) {
+        radius += kernels[i].radius + 1;
+    }
+    return radius;
+}
+
+void apply_box_gaussian_blur(Image* image, float sigma) {
+    if (!image || sigma <= 0) {
+        return;
+    }
+
+    BoxKernel kernels[BLUR_BOX_PASSES];
+    box_gaussian_kernels(sigma, kernels);
+    apply_box_kernels(image, kernels, BLUR_BOX_PASSES);
+}
+
+// Box blur (среднее по квадрату (2 * radius + 1)^2) скользящей суммой
+void filter_box_blur(Image* image, int radius) {
+    if (!image || radius <= 0) {
+        return;
+    }
+
+    BoxKernel kernel = {radius, 1.0 / (2 * radius + 1), 0.0};
+    apply_box_kernels(image, &kernel, 1);
+}
+
+// Box blur filter
+void filter_box(Image* image, void* params) {
+    if (!image || !params) {
+        fprintf(stderr, "Error: filter_box received NULL parameters\n");
+        return;
+    }
+
+    int radius = ((BoxBlurParams*)params)->radius;
+    if (radius <= 0) {
+        fprintf(stderr, "Error: Box blur radius must be positive (got %d)\n", radius);
+        return;
+    }
+
+    filter_log("Applying box blur with radius %d\n", radius);
+    filter_box_blur(image, radius);
+}
+
+// Классы пикселей после подавления немаксимумов
+enum {
+    CANNY_NONE,
+    CANNY_WEAK,      // Выше нижнего порога
+    CANNY_STRONG     // Выше верхнего порога
+};
+
+typedef struct {
+    const Image* image;
+    Image* gray;          // Сглаженная яркость в плоскости 0, ореол 1
+    float* magnitude;     // Квадрат модуля градиента с нулевой рамкой в 1 пиксель
+    uint8_t* classes;     // Направление градиента, после подавления - класс пикселя
+    uint32_t* parent;     // Лес связных компонент граничных пикселей
+    Image* mask;          // Результат, PIXEL_FORMAT_MASK
+    float low;
+    float high;
+    int bands;
+} CannyContext;
+
+// Строки [y_begin, y_end) яркости исходного изображения
+static void canny_gray_rows(void* context, int y_begin, int y_end) {
+    CannyContext* ctx = (CannyContext*)context;
+
+    for (int y = y_begin; y < y_end; y++) {
+        edge_luminance_row(ctx->image, y, image_plane_row(ctx->gray, 0, y));
+    }
+}
+
+// Квадрат модуля и направление градиента Собеля для lanes (не более
+// SIMD_LANES) соседних пикселей. Направление округляется до 45 градусов:
+// 0 - вдоль строки, 1 - по диагонали вниз вправо, 2 - вдоль столбца,
+// 3 - по диагонали вниз влево.
+static inline void canny_gradient(float* restrict magnitude, uint8_t* restrict direction,
+                                  const float* up, const float* mid, const float* down,
+                                  int lanes) {
+    // tg(22.5) и tg(67.5)
+    const float tan_low = 0.41421356f;
+    const float tan_high = 2.41421356f;
+    int codes[SIMD_LANES];
+
+    for (int l = 0; l < lanes; l++) {
+        float gx = (up[l + 1] - up[l - 1]) + 2.0f * (mid[l + 1] - mid[l - 1]) +
+                   (down[l + 1] - down[l - 1]);
+        float gy = (down[l - 1] - up[l - 1]) + 2.0f * (down[l] - up[l]) +
+                   (down[l + 1] - up[l + 1]);
+        float ax = fabsf(gx);
+        float ay = fabsf(gy);
+
+        int diagonal = ay > tan_low * ax;
+        int vertical = ay >= tan_high * ax;
+        int anti = (gx > 0) ^ (gy > 0);
+
+        magnitude[l] = gx * gx + gy * gy;
+        codes[l] = diagonal * (1 + vertical + 2 * anti * (1 - vertical));
+    }
+
+    for (int l = 0; l < lanes; l++) {
+        direction[l] = (uint8_t)codes[l];
+    }
+}
+
+// Строки [y_begin, y_end) градиента: операторы Собеля, модуль и направление
+// за один проход. Хранится квадрат модуля: подавлению и порогам нужно только
+// сравнение модулей, и корень не мешает векторизации.
+static void canny_gradient_rows(void* context, int y_begin, int y_end) {
+    CannyContext* ctx = (CannyContext*)context;
+    int width = ctx->gray->width;
+
+    for (int y = y_begin; y < y_end; y++) {
+        const float* up = image_plane_row(ctx->gray, 0, y - 1);
+        const float* mid = image_plane_row(ctx->gray, 0, y);
+        const float* down = image_plane_row(ctx->gray, 0, y + 1);
+        float* magnitude = ctx->magnitude + (size_t)(y + 1) * (width + 2) + 1;
+        uint8_t* direction = ctx->classes + (size_t)y * width;
+        int x = 0;
+
+        for (; x + SIMD_LANES <= width; x += SIMD_LANES) {
+            canny_gradient(magnitude + x, direction + x, up + x, mid + x, down + x, SIMD_LANES);
+        }
+
+        if (x < width) {
+            canny_gradient(magnitude + x, direction + x, up + x, mid + x, down + x, width - x);
+        }
+    }
+}
+
+// Подавление немаксимумов для lanes (не более SIMD_LANES) соседних пикселей:
+// пиксель остается, если модуль больше соседа против градиента и не меньше
+// соседа по градиенту, и получает класс по порогам. Класс записывается на
+// место направления. Соседи всех направлений читаются сразу, чтобы выбор
+// между ними не мешал векторизации.
+static inline void canny_suppress(uint8_t* restrict classes, const float* m, ptrdiff_t stride,
+                                  float low, float high, int lanes) {
+    int codes[SIMD_LANES];
+
+    for (int l = 0; l < lanes; l++) {
+        codes[l] = classes[l];
+    }
+
+    for (int l = 0; l < lanes; l++) {
+        const float* c = m + l;
+        int d = codes[l];
+
+        float left = c[-1], right = c[1];
+        float up_left = c[-stride - 1], down_right = c[stride + 1];
+        float up = c[-stride], down = c[stride];
+        float up_right = c[-stride + 1], down_left = c[stride - 1];
+
+        float prev = d == 0 ? left : d == 1 ? up_left : d == 2 ? up : up_right;
+        float next = d == 0 ? right : d == 1 ? down_right : d == 2 ? down : down_left;
+        int maximum = (*c > prev) & (*c >= next);
+
+        codes[l] = maximum * ((*c > low) + (*c > high));
+    }
+
+    for (int l = 0; l < lanes; l++) {
+        classes[l] = (uint8_t)codes[l];
+    }
+}
+
+// Строки [y_begin, y_end) подавления немаксимумов. За краями изображения
+// модуль равен 0 (рамка массива модулей).
+static void canny_suppress_rows(void* context, int y_begin, int y_end) {
+    CannyContext* ctx = (CannyContext*)context;
+    int width = ctx->gray->width;
+    ptrdiff_t stride = width + 2;
+
+    // Пороги для квадрата модуля Собеля, который в 4 раза больше модуля перепада
+    float low = 16.0f * ctx->low * ctx->low;
+    float high = 16.0f * ctx->high * ctx->high;
+
+    for (int y = y_begin; y < y_end; y++) {
+        const float* magnitude = ctx->magnitude + (size_t)(y + 1) * stride + 1;
+        uint8_t* classes = ctx->classes + (size_t)y * width;
+        int x = 0;
+
+        for (; x + SIMD_LANES <= width; x += SIMD_LANES) {
+            canny_suppress(classes + x, magnitude + x, stride, low, high, SIMD_LANES);
+        }
+
+        if (x < width) {
+            canny_suppress(classes + x, magnitude + x, stride, low, high, width - x);
+        }
+    }
+}
+
+// Корень компоненты со сжатием пути вдвое
+static uint32_t canny_find(uint32_t* parent, uint32_t p) {
+    while (parent[p] != p) {
+        parent[p] = parent[parent[p]];
+        p = parent[p];
+    }
+    return p;
+}
+
+// Объединение компонент пикселей a и b: корнем становится меньший индекс,
+// класс корня - наибольший класс компоненты
+static void canny_union(uint32_t* parent, uint8_t* classes, uint32_t a, uint32_t b) {
+    a = canny_find(parent, a);
+    b = canny_find(parent, b);
+    if (a == b) {
+        return;
+    }
+
+    if (a < b) {
+        uint32_t t = a;
+        a = b;
+        b = t;
+    }
+
+    parent[a] = b;
+    if (classes[a] > classes[b]) {
+        classes[b] = classes[a];
+    }
+}
+
+// Первая строка полосы band
+static inline int canny_band_row(const CannyContext* ctx, int band) {
+    return (int)((int64_t)ctx->gray->height * band / ctx->bands);
+}
+
+// Связывание граничного пикселя p (столбец x) с соседями в строке выше
+static void canny_link_above(CannyContext* ctx, uint32_t p, int x) {
+    int width = ctx->gray->width;
+    uint32_t above = p - width;
+
+    for (int dx = -1; dx <= 1; dx++) {
+        if (x + dx >= 0 && x + dx < width && ctx->classes[above + dx] != CANNY_NONE) {
+            canny_union(ctx->parent, ctx->classes, p, above + dx);
+        }
+    }
+}
+
+// Полосы [band_begin, band_end) гистерезиса: компоненты внутри полосы
+// (8-связность). Полосы не пересекаются, поэтому их лес строится без
+// синхронизации; лес заполняется только для граничных пикселей.
+static void canny_link_bands(void* context, int band_begin, int band_end) {
+    CannyContext* ctx = (CannyContext*)context;
+    int width = ctx->gray->width;
+    uint32_t* parent = ctx->parent;
+    uint8_t* classes = ctx->classes;
+
+    for (int band = band_begin; band < band_end; band++) {
+        int first = canny_band_row(ctx, band);
+        int last = canny_band_row(ctx, band + 1);
+
+        for (int y = first; y < last; y++) {
+            uint32_t row = (uint32_t)y * (uint32_t)width;
+
+            for (int x = 0; x < width; x++) {
+                uint32_t p = row + x;
+                if (classes[p] == CANNY_NONE) {
+                    continue;
+                }
+
+                parent[p] = p;
+                if (x > 0 && classes[p - 1] != CANNY_NONE) {
+                    canny_union(parent, classes, p, p - 1);
+                }
+                if (y > first) {
+                    canny_link_above(ctx, p, x);
+                }
+            }
+        }
+    }
+}
+
+// Объединение компонент соседних полос по первой строке полосы band
+static void canny_link_band_edge(CannyContext* ctx, int band) {
+    int width = ctx->gray->width;
+    uint32_t row = (uint32_t)canny_band_row(ctx, band) * (uint32_t)width;
+
+    for (int x = 0; x < width; x++) {
+        if (ctx->classes[row + x] != CANNY_NONE) {
+            canny_link_above(ctx, row + x, x);
+        }
+    }
+}
+
+// Строки [y_begin, y_end) результата: граница - пиксель компоненты с сильным
+// пикселем. Лес только читается, поэтому корни ищутся без сжатия путей.
+static void canny_output_rows(void* context, int y_begin, int y_end) {
+    CannyContext* ctx = (CannyContext*)context;
+    int width = ctx->gray->width;
+    int bytes = ctx->mask->stride / 8;
+
+    for (int y = y_begin; y < y_end; y++) {
+        uint8_t* dst = image_mask_row(ctx->mask, y);
+        uint32_t row = (uint32_t)y * (uint32_t)width;
+        memset(dst, 0, bytes);
+
+        for (int x = 0; x < width; x++) {
+            uint32_t p = row + x;
+            if (ctx->classes[p] == CANNY_NONE) {
+                continue;
+            }
+
+            while (ctx->parent[p] != p) {
+                p = ctx->parent[p];
+            }
+
+            if (ctx->classes[p] == CANNY_STRONG) {
+                dst[x / 8] |= (uint8_t)(0x80 >> (x % 8));
+            }
+        }
+    }
+}
+
+// Canny edge detection filter
+void filter_canny(Image* image, void* params) {
+    if (!image || !params) {
+        fprintf(stderr, "Error: filter_canny received NULL parameters\n");
+        return;
+    }
+
+    CannyParams* canny = (CannyParams*)params;
+    if (canny->low < 0 || canny->high > 1 || canny->low > canny->high || canny->sigma < 0) {
+        fprintf(stderr, "Error: Invalid Canny parameters (thresholds %.2f %.2f, sigma %.2f)\n",
+                canny->low, canny->high, canny->sigma);
+        return;
+    }
+
+    int width = image->width;
+    int height = image->height;
+    size_t pixels = (size_t)width * height;
+
+    if (pixels >= UINT32_MAX) {
+        fprintf(stderr, "Error: Image %dx%d is too large for Canny edge detection\n", width, height);
+        return;
+    }
+
+    filter_log("Applying Canny edge detection with thresholds %.2f %.2f, sigma %.2f\n",
+               canny->low, canny->high, canny->sigma);
+
+    CannyContext context;
+    memset(&context, 0, sizeof(CannyContext));
+    context.image = image;
+    context.low = canny->low;
+    context.high = canny->high;
+
+    context.gray = image_create_padded(width, height, 1);
+    context.mask = image_create_format(width, height, PIXEL_FORMAT_MASK);
+    context.magnitude = (float*)calloc(((size_t)width + 2) * ((size_t)height + 2), sizeof(float));
+    context.classes = (uint8_t*)malloc(pixels);
+    context.parent = (uint32_t*)malloc(sizeof(uint32_t) * pixels);
+
+    if (!context.gray || !context.mask || !context.magnitude || !context.classes || !context.parent) {
+        fprintf(stderr, "Error: Memory allocation failed for Canny edge detection\n");
+    } else {
+        // Яркость размывается тем же гауссовым фильтром, что и -blur, но в одной плоскости
+        parallel_for_rows(height, canny_gray_rows, &context);
+        if (canny->sigma > 0) {
+            gaussian_blur_planes(context.gray, canny->sigma, 1);
+        }
+        image_fill_halo(context.gray, filters_border);
+
+        parallel_for_rows(height, canny_gradient_rows, &context);
+        parallel_for_rows(height, canny_suppress_rows, &context);
+
+        // Гистерезис: компоненты полос параллельно, затем последовательное
+        // объединение по первым строкам полос и параллельная запись маски
+        int bands = parallel_get_threads() * CANNY_BANDS_PER_THREAD;
+        context.bands = bands < height ? bands : height;
+
+        parallel_for_rows(context.bands, canny_link_bands, &context);
+        for (int band = 1; band < context.bands; band++) {
+            canny_link_band_edge(&context, band);
+        }
+        parallel_for_rows(height, canny_output_rows, &context);
+
+        image_take(image, context.mask);
+        context.mask = NULL;
+    }
+
+    free(context.parent);
+    free(context.classes);
+    free(context.magnitude);
+    image_destroy(context.mask);
+    image_destroy(context.gray);
+}
+
+typedef struct {
+    const IntegralImage* integral;
+    Image* mask;
+    int radius;
+    double offset;
+} ThresholdContext;
+
+// Яркость (веса grayscale) по средним каналов области [x0, x1) x [y0, y1)
+static double threshold_luminance(const IntegralImage* integral, int x0, int y0, int x1, int y1) {
+    double mean[3];
+    for (int c = 0; c < 3; c++) {
+        integral_mean_variance(integral, c, x0, y0, x1, y1, &mean[c], NULL);
+    }
+    return 0.299 * mean[0] + 0.587 * mean[1] + 0.114 * mean[2];
+}
+
+// Строки [y_begin, y_end) маски адаптивного порога
+static void threshold_rows(void* context, int y_begin, int y_end) {
+    ThresholdContext* ctx = (ThresholdContext*)context;
+    const IntegralImage* integral = ctx->integral;
+    int width = integral->width;
+    int radius = ctx->radius;
+    int bytes = ctx->mask->stride / 8;
+
+    for (int y = y_begin; y < y_end; y++) {
+        uint8_t* dst = image_mask_row(ctx->mask, y);
+        memset(dst, 0, bytes);
+
+        for (int x = 0; x < width; x++) {
+            // Окно обрезается краями изображения; пиксель - область 1x1 той же таблицы
+            double local = threshold_luminance(integral, x - radius, y - radius,
+                                               x + radius + 1, y + radius + 1);
+            double value = threshold_luminance(integral, x, y, x + 1, y + 1);
+
+            if (value > local - ctx->offset) {
+                dst[x / 8] |= (uint8_t)(0x80 >> (x % 8));
+            }
+        }
+    }
+}
+
+// Adaptive threshold filter: средние окон по таблице сумм за O(1) на пиксель
+void filter_adaptive_threshold(Image* image, void* params) {
+    if (!image || !params) {
+        fprintf(stderr, "Error: filter_adaptive_threshold received NULL parameters\n");
+        return;
+    }
+
+    ThresholdParams* threshold = (ThresholdParams*)params;
+    if (threshold->radius <= 0) {
+        fprintf(stderr, "Error: Threshold radius must be positive (got %d)\n", threshold->radius);
+        return;
+    }
+
+    filter_log("Applying adaptive threshold with radius %d, offset %.3f\n",
+               threshold->radius, threshold->offset);
+
+    IntegralImage* integral = integral_create(image, false);
+    Image* mask = integral ? image_create_format(image->width, image->height, PIXEL_FORMAT_MASK) : NULL;
+
+    if (mask) {
+        ThresholdContext context = {integral, mask, threshold->radius, threshold->offset};
+        parallel_for_rows(image->height, threshold_rows, &context);
+        image_take(image, mask);
+    }
+
+    integral_destroy(integral);
+}
+
+// Вспомогательная функция для нахождения медианного цвета
+Color get_median_color(Color* colors, int count) {
+    if (count <= 0) {
+        return color_create(0, 0, 0);
+    }
+
+    // Простая реализация - возвращаем средний цвет
     Color sum = color_create(0, 0, 0);
     for (int i = 0; i < count; i++) {
         sum = color_add(sum, colors[i]);
     }
 
     return color_mul(sum, 1.0f / count);
-}
\ No newline at end of file
+}
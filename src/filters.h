@@ -7,32 +7,89 @@
 typedef struct {
     int width;
     int height;
+    int x;          // Смещение левого верхнего угла области
+    int y;
 } CropParams;
 
 typedef struct {
     float threshold;
 } EdgeParams;
 
+// Пороги гистерезиса Canny (0-1, low <= high) и sigma предварительного
+// гауссова размытия (0 - без размытия)
+typedef struct {
+    float low;
+    float high;
+    float sigma;
+} CannyParams;
+
 typedef struct {
     int window_size;
 } MedianParams;
 
+// Адаптивный порог: пиксель белый, если его яркость больше средней яркости
+// окна (2 * radius + 1)^2 вокруг него, уменьшенной на offset
+typedef struct {
+    int radius;
+    float offset;
+} ThresholdParams;
+
+// Способ гауссова размытия
+typedef enum {
+    BLUR_GAUSSIAN,      // Ядро Гаусса (рекурсивный фильтр для больших sigma)
+    BLUR_BOX            // Три прохода расширенного box-фильтра
+} BlurMode;
+
 typedef struct {
     float sigma;
+    BlurMode mode;
 } BlurParams;
 
+typedef struct {
+    int radius;
+} BoxBlurParams;
+
 typedef struct {
     float intensity;
 } VignetteParams;
 
+// Наибольшая сторона ядра свертки
+#define CONV_MAX_SIZE 63
+
+// Ядро свертки width x height (нечетные стороны), веса по строкам
+typedef struct {
+    int width;
+    int height;
+    float divisor;      // 0 - сумма весов (1, если она равна 0)
+    float weights[];
+} ConvParams;
+
+// Шаг слитого поточечного прохода
+typedef enum {
+    POINTWISE_GRAYSCALE,
+    POINTWISE_NEGATIVE,
+    POINTWISE_SEPIA,
+    POINTWISE_VIGNETTE
+} PointwiseOp;
+
+typedef struct {
+    PointwiseOp op;
+    float intensity;    // Для виньетки, в диапазоне [0, 1]
+} PointwiseStep;
+
 // Базовые фильтры
 void filter_crop(Image* image, void* params);
 void filter_grayscale(Image* image, void* params);
 void filter_negative(Image* image, void* params);
 void filter_sharpening(Image* image, void* params);
+void filter_emboss(Image* image, void* params);
 void filter_edge_detection(Image* image, void* params);
+void filter_canny(Image* image, void* params);
+void filter_adaptive_threshold(Image* image, void* params);
 void filter_median(Image* image, void* params);
 void filter_gaussian_blur(Image* image, void* params);
+void filter_box(Image* image, void* params);
+void filter_convolution(Image* image, void* params);
 
 // Дополнительные фильтры
 void filter_sepia(Image* image, void* params);
@@ -40,11 +97,45 @@ void filter_vignette(Image* image, void* params);
 
 // Вспомогательные функции
 void apply_matrix_filter(Image* image, float kernel[3][3], float divisor);
+
+// Свертка с ядром width x height (веса по строкам, нечетные стороны до
+// CONV_MAX_SIZE); за краями изображение продолжается согласно
+// filters_get_border. Ядро ранга 1 выполняется двумя одномерными
+// проходами. false при ошибке параметров или памяти.
+bool apply_convolution(Image* image, const float* kernel, int width, int height, float divisor);
 void apply_gaussian_blur(Image* image, float sigma);
+
+// Радиус влияния размытия: на каком расстоянии соседи еще меняют результат
+int gaussian_blur_radius(float sigma);
+
+// Приближение гауссова размытия проходами box-фильтра со скользящей суммой:
+// стоимость не зависит от sigma, дисперсия совпадает с гауссовой точно.
+// box_gaussian_radius - радиус влияния всех проходов.
+void apply_box_gaussian_blur(Image* image, float sigma);
+int box_gaussian_radius(float sigma);
+
+void apply_vignette(Image* image, float intensity, int x_offset, int y_offset,
+                    int full_width, int full_height);
 Color get_median_color(Color* colors, int count);
 
+// Цепочка поточечных фильтров за один проход по изображению. Результат
+// совпадает с последовательным применением фильтров, включая форматы
+// хранения и ограничение значений после каждого шага. Смещение и полные
+// размеры изображения - как у apply_vignette. На изображениях U8 цепочки
+// из негативов или с grayscale заменяются поиском в таблицах на 256 значений.
+void apply_pointwise_chain(Image* image, const PointwiseStep* steps, int count,
+                           int x_offset, int y_offset, int full_width, int full_height);
+
+// Включение и отключение сообщений фильтров о ходе работы
+void filters_set_verbose(bool verbose);
+
+// Продолжение изображения за краями (по умолчанию BORDER_CLAMP) в свертках,
+// резкости, поиске границ и гауссовом размытии ядром. Медиана и box-фильтры
+// всегда продолжают изображение ближайшим пикселем края.
+void filters_set_border(Border border);
+Border filters_get_border(void);
+
 // Утилиты фильтров
 void filter_box_blur(Image* image, int radius);
-void filter_emboss(Image* image);
 
 #endif // FILTERS_H
\ No newline at end of file
@@ -1,11 +1,187 @@
 #include "image.h"
+#include "parallel.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stdatomic.h>
+
+// Выделение выровненного буфера пикселей
+static void* alloc_aligned(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, IMAGE_ALIGNMENT);
+#else
+    return aligned_alloc(IMAGE_ALIGNMENT, size);
+#endif
+}
+
+static void free_aligned(void* data) {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
+
+// Свободный буфер пула
+typedef struct {
+    void* data;
+    size_t size;
+} PoolBuffer;
+
+struct ImagePool {
+    PoolBuffer* free_buffers;
+    int free_count;
+    int free_capacity;
+    ImagePoolStats stats;
+};
+
+// Пул, из которого сейчас выделяются буферы изображений (свой у каждого потока)
+static _Thread_local ImagePool* active_pool = NULL;
+
+// Байт выделено новыми буферами пикселей (для -profile)
+static atomic_size_t total_bytes_allocated = 0;
+
+// Выделение буфера пикселей: из активного пула, если он есть.
+// Новые буферы обнуляются, буферы из пула сохраняют прежнее содержимое.
+static void* alloc_pixels(size_t size, size_t* allocated) {
+    // aligned_alloc требует размер, кратный выравниванию
+    size = (size + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+
+    ImagePool* pool = active_pool;
+    if (pool) {
+        // Наименьший подходящий свободный буфер
+        int best = -1;
+        for (int i = 0; i < pool->free_count; i++) {
+            if (pool->free_buffers[i].size >= size &&
+                (best < 0 || pool->free_buffers[i].size < pool->free_buffers[best].size)) {
+                best = i;
+            }
+        }
+
+        if (best >= 0) {
+            PoolBuffer buffer = pool->free_buffers[best];
+            pool->free_buffers[best] = pool->free_buffers[--pool->free_count];
+            pool->stats.reused++;
+            *allocated = buffer.size;
+            return buffer.data;
+        }
+    }
+
+    void* data = alloc_aligned(size);
+    if (data) {
+        memset(data, 0, size);
+        *allocated = size;
+        atomic_fetch_add(&total_bytes_allocated, size);
+
+        if (pool) {
+            pool->stats.allocated++;
+            pool->stats.bytes_allocated += size;
+        }
+    }
+    return data;
+}
+
+// Освобождение буфера пикселей: возврат в активный пул или в систему
+static void free_pixels(void* data, size_t size) {
+    if (!data) {
+        return;
+    }
+
+    ImagePool* pool = active_pool;
+    if (pool) {
+        if (pool->free_count == pool->free_capacity) {
+            int capacity = pool->free_capacity ? pool->free_capacity * 2 : 8;
+            PoolBuffer* buffers = (PoolBuffer*)realloc(pool->free_buffers,
+                                                       sizeof(PoolBuffer) * capacity);
+            if (!buffers) {
+                free_aligned(data);
+                return;
+            }
+            pool->free_buffers = buffers;
+            pool->free_capacity = capacity;
+        }
+
+        pool->free_buffers[pool->free_count].data = data;
+        pool->free_buffers[pool->free_count].size = size;
+        pool->free_count++;
+        return;
+    }
+
+    free_aligned(data);
+}
+
+ImagePool* image_pool_create(void) {
+    ImagePool* pool = (ImagePool*)calloc(1, sizeof(ImagePool));
+    if (!pool) {
+        fprintf(stderr, "Error: Memory allocation failed for image pool\n");
+    }
+    return pool;
+}
+
+void image_pool_destroy(ImagePool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    if (active_pool == pool) {
+        active_pool = NULL;
+    }
+
+    for (int i = 0; i < pool->free_count; i++) {
+        free_aligned(pool->free_buffers[i].data);
+    }
+
+    free(pool->free_buffers);
+    free(pool);
+}
+
+ImagePool* image_pool_set_active(ImagePool* pool) {
+    ImagePool* previous = active_pool;
+    active_pool = pool;
+    return previous;
+}
+
+ImagePoolStats image_pool_get_stats(const ImagePool* pool) {
+    ImagePoolStats stats = {0};
+    return pool ? pool->stats : stats;
+}
+
+size_t image_total_bytes_allocated(void) {
+    return atomic_load(&total_bytes_allocated);
+}
+
+// Размер буфера пикселей изображения в байтах
+static size_t image_buffer_size(const Image* image) {
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        return image->plane_size * 3 * sizeof(float);
+    }
+    if (image->format == PIXEL_FORMAT_MASK) {
+        return (size_t)image->stride / 8 * image->height;
+    }
+    return pixel_format_size(image->format) * image->stride * image->height;
+}
+
+// Расчет шага строки и размера плоскостей для формата
+static void image_init_layout(Image* image) {
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        image->stride = (image->width + IMAGE_PLANE_ALIGN - 1) / IMAGE_PLANE_ALIGN * IMAGE_PLANE_ALIGN;
+        image->plane_size = (size_t)image->stride * image->height;
+    } else if (image->format == PIXEL_FORMAT_MASK) {
+        image->stride = (image->width + IMAGE_MASK_ALIGN - 1) / IMAGE_MASK_ALIGN * IMAGE_MASK_ALIGN;
+        image->plane_size = 0;
+    } else {
+        image->stride = image->width;
+        image->plane_size = 0;
+    }
+}
 
 Image* image_create(int width, int height) {
+    return image_create_format(width, height, PIXEL_FORMAT_FLOAT);
+}
+
+Image* image_create_format(int width, int height, PixelFormat format) {
     if (width <= 0 || height <= 0) {
         fprintf(stderr, "Error: Invalid image dimensions %dx%d\n", width, height);
         return NULL;
@@ -17,11 +193,15 @@ Image* image_create(int width, int height) {
         return NULL;
     }
 
+    image->format = format;
     image->width = width;
     image->height = height;
-    image->capacity = width * height;
+    image->capacity = (size_t)width * height;
+    image->halo = 0;
+    image_init_layout(image);
 
-    image->data = (Color*)calloc(image->capacity, sizeof(Color));
+    image->buffer = alloc_pixels(image_buffer_size(image), &image->buffer_size);
+    image->data = image->buffer;
     if (!image->data) {
         fprintf(stderr, "Error: Memory allocation failed for image data\n");
         free(image);
@@ -33,7 +213,7 @@ Image* image_create(int width, int height) {
 
 void image_destroy(Image* image) {
     if (image) {
-        free(image->data);
+        free_pixels(image->buffer, image->buffer_size);
         free(image);
     }
 }
@@ -43,21 +223,439 @@ Image* image_copy(const Image* src) {
         return NULL;
     }
 
-    Image* dst = image_create(src->width, src->height);
+    Image* dst = image_create_format(src->width, src->height, src->format);
     if (!dst) {
         return NULL;
     }
 
-    memcpy(dst->data, src->data, sizeof(Color) * src->width * src->height);
+    // src может быть областью другого изображения, поэтому копируем построчно
+    image_copy_region(dst, 0, 0, src, 0, 0, src->width, src->height);
     return dst;
 }
 
+Image* image_create_padded(int width, int height, int halo) {
+    if (width <= 0 || height <= 0 || halo < 0) {
+        fprintf(stderr, "Error: Invalid padded image dimensions %dx%d (halo %d)\n", width, height, halo);
+        return NULL;
+    }
+
+    Image* image = (Image*)malloc(sizeof(Image));
+    if (!image) {
+        fprintf(stderr, "Error: Memory allocation failed for image structure\n");
+        return NULL;
+    }
+
+    // Левый ореол округляется до выравнивания, чтобы строки начинались с выровненного адреса
+    int left = (halo + IMAGE_PLANE_ALIGN - 1) / IMAGE_PLANE_ALIGN * IMAGE_PLANE_ALIGN;
+
+    image->format = PIXEL_FORMAT_PLANAR;
+    image->width = width;
+    image->height = height;
+    image->capacity = (size_t)width * height;
+    image->halo = halo;
+    image->stride = (left + width + halo + IMAGE_PLANE_ALIGN - 1) / IMAGE_PLANE_ALIGN * IMAGE_PLANE_ALIGN;
+    image->plane_size = (size_t)image->stride * (height + 2 * halo);
+
+    image->buffer = alloc_pixels(image_buffer_size(image), &image->buffer_size);
+    if (!image->buffer) {
+        fprintf(stderr, "Error: Memory allocation failed for image data\n");
+        free(image);
+        return NULL;
+    }
+
+    image->data = (float*)image->buffer + (size_t)image->stride * halo + left;
+    return image;
+}
+
+int border_index(int index, int count, BorderMode mode) {
+    if (index >= 0 && index < count) {
+        return index;
+    }
+
+    switch (mode) {
+        case BORDER_CONSTANT:
+            return -1;
+
+        case BORDER_WRAP:
+            index %= count;
+            return index < 0 ? index + count : index;
+
+        case BORDER_MIRROR: {
+            if (count == 1) {
+                return 0;
+            }
+
+            // Отражение периодично с периодом 2 * (count - 1)
+            int period = 2 * (count - 1);
+            index %= period;
+            if (index < 0) index += period;
+            return index < count ? index : period - index;
+        }
+
+        default:
+            return index < 0 ? 0 : count - 1;
+    }
+}
+
+void border_fill_row(float* row, int width, int halo, Border border) {
+    for (int x = -halo; x < 0; x++) {
+        int source = border_index(x, width, border.mode);
+        row[x] = source >= 0 ? row[source] : border.value;
+    }
+
+    for (int x = width; x < width + halo; x++) {
+        int source = border_index(x, width, border.mode);
+        row[x] = source >= 0 ? row[source] : border.value;
+    }
+}
+
+typedef struct {
+    Image* image;
+    const Image* source;     // Откуда копируются пиксели (NULL - только ореол)
+    Border border;
+} HaloContext;
+
+// Строки [y_begin, y_end): копирование пикселей и ореол слева и справа
+static void halo_rows(void* context, int y_begin, int y_end) {
+    HaloContext* ctx = (HaloContext*)context;
+    Image* image = ctx->image;
+
+    for (int c = 0; c < 3; c++) {
+        for (int y = y_begin; y < y_end; y++) {
+            float* row = image_plane_row(image, c, y);
+            if (ctx->source) {
+                memcpy(row, image_plane_row(ctx->source, c, y), sizeof(float) * image->width);
+            }
+            border_fill_row(row, image->width, image->halo, ctx->border);
+        }
+    }
+}
+
+// Строка ореола сверху или снизу: целиком, вместе с ореолом слева и справа
+static void halo_fill_row(Image* image, int c, int y, Border border) {
+    int halo = image->halo;
+    size_t count = (size_t)image->width + 2 * halo;
+    float* row = image_plane_row(image, c, y) - halo;
+    int source = border_index(y, image->height, border.mode);
+
+    if (source >= 0) {
+        memcpy(row, image_plane_row(image, c, source) - halo, sizeof(float) * count);
+    } else {
+        for (size_t x = 0; x < count; x++) {
+            row[x] = border.value;
+        }
+    }
+}
+
+// Ореол сверху и снизу; строки изображения уже дополнены слева и справа
+static void halo_fill_rows(Image* image, Border border) {
+    for (int c = 0; c < 3; c++) {
+        for (int y = -image->halo; y < 0; y++) {
+            halo_fill_row(image, c, y, border);
+        }
+        for (int y = image->height; y < image->height + image->halo; y++) {
+            halo_fill_row(image, c, y, border);
+        }
+    }
+}
+
+void image_fill_halo(Image* image, Border border) {
+    if (!image || image->format != PIXEL_FORMAT_PLANAR || image->halo <= 0) {
+        return;
+    }
+
+    HaloContext context = {image, NULL, border};
+    parallel_for_rows(image->height, halo_rows, &context);
+    halo_fill_rows(image, border);
+}
+
+Image* image_pad(const Image* src, int halo, Border border) {
+    if (!src || src->format != PIXEL_FORMAT_PLANAR) {
+        fprintf(stderr, "Error: Cannot pad image (planar image required)\n");
+        return NULL;
+    }
+
+    Image* image = image_create_padded(src->width, src->height, halo);
+    if (!image) {
+        return NULL;
+    }
+
+    // Пиксели и ореол слева и справа - за один проход по строкам
+    HaloContext context = {image, src, border};
+    parallel_for_rows(image->height, halo_rows, &context);
+    halo_fill_rows(image, border);
+    return image;
+}
+
+void image_take(Image* image, Image* src) {
+    if (!image || !src) {
+        return;
+    }
+
+    free_pixels(image->buffer, image->buffer_size);
+    *image = *src;
+    free(src);
+}
+
+ImageView image_view(const Image* image, int x, int y, int width, int height) {
+    ImageView view = {0};
+    if (!image) {
+        return view;
+    }
+
+    // Ограничение области размерами изображения
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x > image->width) x = image->width;
+    if (y > image->height) y = image->height;
+    if (width > image->width - x) width = image->width - x;
+    if (height > image->height - y) height = image->height - y;
+
+    view.base = image->data;
+    view.offset = (size_t)y * image->stride + x;
+    view.format = image->format;
+    view.width = width > 0 ? width : 0;
+    view.height = height > 0 ? height : 0;
+    view.stride = image->stride;
+    view.plane_size = image->plane_size;
+    return view;
+}
+
+bool image_apply_view(Image* image, ImageView view) {
+    if (!image || view.base != image->data || view.width <= 0 || view.height <= 0) {
+        return false;
+    }
+
+    // Пиксели MASK адресуются байтами по 8, область должна начинаться с границы байта
+    if (view.format == PIXEL_FORMAT_MASK && view.offset % 8 != 0) {
+        return false;
+    }
+
+    // В PLANAR смещение задается внутри плоскости R, остальные плоскости
+    // находятся на том же расстоянии plane_size
+    size_t element_size = view.format == PIXEL_FORMAT_PLANAR ?
+                          sizeof(float) : pixel_format_size(view.format);
+
+    // Буфер остается прежним, меняются только начало и размеры
+    image->data = view.format == PIXEL_FORMAT_MASK ?
+                  (uint8_t*)view.base + view.offset / 8 :
+                  (uint8_t*)view.base + view.offset * element_size;
+    image->width = view.width;
+    image->height = view.height;
+    image->capacity = (size_t)view.width * view.height;
+    return true;
+}
+
+// Копирование width пикселей маски со сдвигом: с границ байтов - целыми
+// байтами, остальные пиксели - по одному
+static void mask_copy_row(uint8_t* dst, int dst_x, const uint8_t* src, int src_x, int width) {
+    int x = 0;
+
+    if (src_x % 8 == 0 && dst_x % 8 == 0) {
+        x = width / 8 * 8;
+        memcpy(dst + dst_x / 8, src + src_x / 8, (size_t)x / 8);
+    }
+
+    for (; x < width; x++) {
+        int sx = src_x + x;
+        int dx = dst_x + x;
+        int bit = (src[sx / 8] >> (7 - sx % 8)) & 1;
+        uint8_t mask = (uint8_t)(0x80 >> (dx % 8));
+
+        dst[dx / 8] = (uint8_t)(bit ? dst[dx / 8] | mask : dst[dx / 8] & ~mask);
+    }
+}
+
+void image_copy_region(Image* dst, int dst_x, int dst_y,
+                       const Image* src, int src_x, int src_y,
+                       int width, int height) {
+    if (!dst || !src || dst->format != src->format) {
+        return;
+    }
+
+    if (src->format == PIXEL_FORMAT_PLANAR) {
+        for (int c = 0; c < 3; c++) {
+            for (int y = 0; y < height; y++) {
+                memcpy(image_plane_row(dst, c, dst_y + y) + dst_x,
+                       image_plane_row(src, c, src_y + y) + src_x,
+                       sizeof(float) * width);
+            }
+        }
+        return;
+    }
+
+    if (src->format == PIXEL_FORMAT_MASK) {
+        for (int y = 0; y < height; y++) {
+            mask_copy_row(image_mask_row(dst, dst_y + y), dst_x,
+                          image_mask_row(src, src_y + y), src_x, width);
+        }
+        return;
+    }
+
+    size_t pixel_size = pixel_format_size(src->format);
+    for (int y = 0; y < height; y++) {
+        memcpy((uint8_t*)dst->data + pixel_size * ((size_t)dst->stride * (dst_y + y) + dst_x),
+               (const uint8_t*)src->data + pixel_size * ((size_t)src->stride * (src_y + y) + src_x),
+               pixel_size * width);
+    }
+}
+
+size_t pixel_format_size(PixelFormat format) {
+    switch (format) {
+        case PIXEL_FORMAT_U8:     return sizeof(Color8);
+        case PIXEL_FORMAT_U16:    return sizeof(Color16);
+        case PIXEL_FORMAT_FLOAT:  return sizeof(Color);
+        case PIXEL_FORMAT_PLANAR: return sizeof(Color);
+        case PIXEL_FORMAT_MASK:   return sizeof(uint8_t);
+    }
+    return sizeof(Color);
+}
+
+int pixel_format_max(PixelFormat format) {
+    switch (format) {
+        case PIXEL_FORMAT_U8:  return 255;
+        case PIXEL_FORMAT_U16: return 65535;
+        default:               return 1;
+    }
+}
+
+const char* pixel_format_name(PixelFormat format) {
+    switch (format) {
+        case PIXEL_FORMAT_U8:     return "u8";
+        case PIXEL_FORMAT_U16:    return "u16";
+        case PIXEL_FORMAT_FLOAT:  return "float";
+        case PIXEL_FORMAT_PLANAR: return "planar";
+        case PIXEL_FORMAT_MASK:   return "mask";
+    }
+    return "unknown";
+}
+
+// Чтение пикселя с приведением к float [0, 1]
+static Color load_pixel(const Image* image, int x, int y) {
+    size_t index = (size_t)y * image->stride + x;
+
+    switch (image->format) {
+        case PIXEL_FORMAT_U8: {
+            Color8 c = ((const Color8*)image->data)[index];
+            return color_create(c.r / 255.0f, c.g / 255.0f, c.b / 255.0f);
+        }
+        case PIXEL_FORMAT_U16: {
+            Color16 c = ((const Color16*)image->data)[index];
+            return color_create(c.r / 65535.0f, c.g / 65535.0f, c.b / 65535.0f);
+        }
+        case PIXEL_FORMAT_PLANAR: {
+            const float* plane = (const float*)image->data;
+            return color_create(plane[index],
+                                plane[index + image->plane_size],
+                                plane[index + image->plane_size * 2]);
+        }
+        case PIXEL_FORMAT_MASK: {
+            float value = (((const uint8_t*)image->data)[index / 8] >> (7 - index % 8)) & 1 ? 1.0f : 0.0f;
+            return color_create(value, value, value);
+        }
+        default:
+            return ((const Color*)image->data)[index];
+    }
+}
+
+// Запись пикселя с ограничением и округлением до формата изображения
+static void store_pixel(Image* image, int x, int y, Color color) {
+    size_t index = (size_t)y * image->stride + x;
+    Color c = color_clamp(color);
+
+    switch (image->format) {
+        case PIXEL_FORMAT_U8: {
+            Color8 q = {
+                (uint8_t)(c.r * 255.0f + 0.5f),
+                (uint8_t)(c.g * 255.0f + 0.5f),
+                (uint8_t)(c.b * 255.0f + 0.5f)
+            };
+            ((Color8*)image->data)[index] = q;
+            break;
+        }
+        case PIXEL_FORMAT_U16: {
+            Color16 q = {
+                (uint16_t)(c.r * 65535.0f + 0.5f),
+                (uint16_t)(c.g * 65535.0f + 0.5f),
+                (uint16_t)(c.b * 65535.0f + 0.5f)
+            };
+            ((Color16*)image->data)[index] = q;
+            break;
+        }
+        case PIXEL_FORMAT_PLANAR: {
+            float* plane = (float*)image->data;
+            plane[index] = c.r;
+            plane[index + image->plane_size] = c.g;
+            plane[index + image->plane_size * 2] = c.b;
+            break;
+        }
+        case PIXEL_FORMAT_MASK: {
+            // Белый - пиксели с яркостью от половины
+            uint8_t* byte = (uint8_t*)image->data + index / 8;
+            uint8_t mask = (uint8_t)(0x80 >> (index % 8));
+            *byte = (uint8_t)(color_luminance(c) >= 0.5f ? *byte | mask : *byte & ~mask);
+            break;
+        }
+        default:
+            ((Color*)image->data)[index] = c;
+            break;
+    }
+}
+
+// Строки [y_begin, y_end) преобразования формата: context - {src, dst}
+static void convert_rows(void* context, int y_begin, int y_end) {
+    const Image* const* pair = (const Image* const*)context;
+    const Image* src = pair[0];
+    Image* dst = (Image*)pair[1];
+
+    for (int y = y_begin; y < y_end; y++) {
+        for (int x = 0; x < src->width; x++) {
+            store_pixel(dst, x, y, load_pixel(src, x, y));
+        }
+    }
+}
+
+bool image_convert(Image* image, PixelFormat format) {
+    if (!image) {
+        return false;
+    }
+
+    if (image->format == format) {
+        return true;
+    }
+
+    Image* converted = image_create_format(image->width, image->height, format);
+    if (!converted) {
+        fprintf(stderr, "Error: Memory allocation failed for %s image data\n",
+                pixel_format_name(format));
+        return false;
+    }
+
+    const Image* pair[2] = {image, converted};
+    parallel_for_rows(image->height, convert_rows, pair);
+
+    image_take(image, converted);
+    return true;
+}
+
+bool image_promote_float(Image* image) {
+    if (!image) {
+        return false;
+    }
+
+    if (image->format == PIXEL_FORMAT_FLOAT || image->format == PIXEL_FORMAT_PLANAR) {
+        return true;
+    }
+
+    return image_convert(image, PIXEL_FORMAT_PLANAR);
+}
+
 Color image_get_pixel(const Image* image, int x, int y) {
     if (!image || !image_is_valid_coord(image, x, y)) {
         return color_create(0, 0, 0);
     }
 
-    return image->data[y * image->width + x];
+    return load_pixel(image, x, y);
 }
 
 void image_set_pixel(Image* image, int x, int y, Color color) {
@@ -65,7 +663,7 @@ void image_set_pixel(Image* image, int x, int y, Color color) {
         return;
     }
 
-    image->data[y * image->width + x] = color_clamp(color);
+    store_pixel(image, x, y, color);
 }
 
 bool image_is_valid_coord(const Image* image, int x, int y) {
@@ -77,8 +675,8 @@ void image_resize(Image* image, int new_width, int new_height) {
         return;
     }
 
-    Color* new_data = (Color*)calloc(new_width * new_height, sizeof(Color));
-    if (!new_data) {
+    Image* resized = image_create_format(new_width, new_height, image->format);
+    if (!resized) {
         return;
     }
 
@@ -94,28 +692,47 @@ void image_resize(Image* image, int new_width, int new_height) {
             if (src_x >= image->width) src_x = image->width - 1;
             if (src_y >= image->height) src_y = image->height - 1;
 
-            new_data[y * new_width + x] = image_get_pixel(image, src_x, src_y);
+            image_copy_region(resized, x, y, image, src_x, src_y, 1, 1);
         }
     }
 
-    free(image->data);
-    image->data = new_data;
-    image->width = new_width;
-    image->height = new_height;
-    image->capacity = new_width * new_height;
+    image_take(image, resized);
 }
 
 void image_fill(Image* image, Color color) {
     if (!image) return;
 
-    for (int i = 0; i < image->width * image->height; i++) {
-        image->data[i] = color_clamp(color);
+    for (int y = 0; y < image->height; y++) {
+        for (int x = 0; x < image->width; x++) {
+            store_pixel(image, x, y, color);
+        }
     }
 }
 
 void image_clear(Image* image) {
     if (!image) return;
-    memset(image->data, 0, sizeof(Color) * image->width * image->height);
+
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        for (int c = 0; c < 3; c++) {
+            for (int y = 0; y < image->height; y++) {
+                memset(image_plane_row(image, c, y), 0, sizeof(float) * image->width);
+            }
+        }
+        return;
+    }
+
+    if (image->format == PIXEL_FORMAT_MASK) {
+        for (int y = 0; y < image->height; y++) {
+            memset(image_mask_row(image, y), 0, ((size_t)image->width + 7) / 8);
+        }
+        return;
+    }
+
+    size_t pixel_size = pixel_format_size(image->format);
+    for (int y = 0; y < image->height; y++) {
+        memset((uint8_t*)image->data + pixel_size * image->stride * y, 0,
+               pixel_size * image->width);
+    }
 }
 
 // Функции для работы с цветом
@@ -10,21 +10,158 @@ typedef struct {
     float r, g, b;
 } Color;
 
+// Цвет с 8 битами на канал
+typedef struct {
+    uint8_t r, g, b;
+} Color8;
+
+// Цвет с 16 битами на канал
+typedef struct {
+    uint16_t r, g, b;
+} Color16;
+
+// Формат хранения пикселей
+typedef enum {
+    PIXEL_FORMAT_U8,    // Color8, 3 байта на пиксель
+    PIXEL_FORMAT_U16,   // Color16, 6 байт на пиксель
+    PIXEL_FORMAT_FLOAT, // Color, 12 байт на пиксель
+    PIXEL_FORMAT_PLANAR,// float, отдельные выровненные плоскости R, G, B
+    PIXEL_FORMAT_MASK   // 1 бит на пиксель (черный или белый), 8 пикселей в байте
+} PixelFormat;
+
+// Выравнивание буферов пикселей и строк плоскостей (байт)
+#define IMAGE_ALIGNMENT 64
+#define IMAGE_PLANE_ALIGN (IMAGE_ALIGNMENT / (int)sizeof(float))
+
+// Выравнивание строк MASK в пикселях: строка занимает целое число 32-битных
+// слов, как строка 1-битного BMP
+#define IMAGE_MASK_ALIGN 32
+
 // Структура для представления изображения
 typedef struct {
-    Color* data;
+    void* data;          // Color8*, Color16*, Color* или float* плоскости R
+    void* buffer;        // Выделенный буфер пикселей (data может указывать внутрь)
+    size_t buffer_size;  // Размер buffer в байтах
+    PixelFormat format;
     int width;
     int height;
-    int capacity;
+    int stride;          // Шаг строки в пикселях (для PLANAR кратен IMAGE_PLANE_ALIGN,
+                         // для MASK - IMAGE_MASK_ALIGN)
+    size_t plane_size;   // Расстояние между плоскостями PLANAR в float
+    size_t capacity;     // Число пикселей (width * height)
+    int halo;            // Столбцов и строк ореола за каждым краем (PLANAR)
 } Image;
 
-// Создание и уничтожение изображения
+// Продолжение изображения за краями для соседей у границы
+typedef enum {
+    BORDER_CLAMP,        // Ближайший пиксель края: aaa|abcd|ddd
+    BORDER_MIRROR,       // Отражение без повтора края: dcb|abcd|cba
+    BORDER_WRAP,         // Периодическое продолжение: bcd|abcd|abc
+    BORDER_CONSTANT      // Постоянное значение
+} BorderMode;
+
+typedef struct {
+    BorderMode mode;
+    float value;         // Значение каналов для BORDER_CONSTANT, [0, 1]
+} Border;
+
+// Прямоугольная область изображения без копирования пикселей
+typedef struct {
+    void* base;          // Начало данных исходного изображения
+    size_t offset;       // Смещение первого пикселя области (в пикселях)
+    PixelFormat format;
+    int width;
+    int height;
+    int stride;          // Шаг строки исходного изображения
+    size_t plane_size;
+} ImageView;
+
+// Строка канала изображения PLANAR (0 - R, 1 - G, 2 - B)
+static inline float* image_plane_row(const Image* image, int channel, int y) {
+    return (float*)image->data + image->plane_size * channel + (size_t)image->stride * y;
+}
+
+// Строка изображения MASK: старший бит байта - левый из его 8 пикселей
+static inline uint8_t* image_mask_row(const Image* image, int y) {
+    return (uint8_t*)image->data + (size_t)image->stride / 8 * y;
+}
+
+// Пул буферов пикселей. Пока пул активен, освобождаемые буферы изображений
+// возвращаются в него и выдаются повторно вместо новых выделений.
+typedef struct ImagePool ImagePool;
+
+typedef struct {
+    int allocated;          // Новых буферов выделено
+    int reused;             // Буферов выдано повторно
+    size_t bytes_allocated; // Байт выделено новыми буферами
+} ImagePoolStats;
+
+ImagePool* image_pool_create(void);
+void image_pool_destroy(ImagePool* pool);
+
+// Установка активного пула потока (NULL - без пула), возвращает предыдущий.
+// Активный пул задается для каждого потока отдельно.
+ImagePool* image_pool_set_active(ImagePool* pool);
+ImagePoolStats image_pool_get_stats(const ImagePool* pool);
+
+// Всего байт, выделенных новыми буферами пикселей во всех потоках с начала
+// работы (без буферов, выданных пулами повторно)
+size_t image_total_bytes_allocated(void);
+
+// Создание и уничтожение изображения.
+// Буфер из пула не обнуляется: содержимое нового изображения не определено.
 Image* image_create(int width, int height);
+Image* image_create_format(int width, int height, PixelFormat format);
 void image_destroy(Image* image);
 
 // Копирование изображения
 Image* image_copy(const Image* src);
 
+// Изображение PLANAR с ореолом: строки плоскостей доступны в столбцах
+// [-halo, width + halo), а строки - в диапазоне [-halo, height + halo),
+// так что соседи пикселей у краев читаются без проверок координат.
+// Ореол не заполнен; начало каждой строки выровнено.
+Image* image_create_padded(int width, int height, int halo);
+
+// Заполнение ореола изображения по его пикселям согласно border
+void image_fill_halo(Image* image, Border border);
+
+// Копия изображения PLANAR с ореолом halo, заполненным согласно border
+Image* image_pad(const Image* src, int halo, Border border);
+
+// Индекс в ряду из count пикселей, которым продолжается ряд в точке index;
+// -1 для BORDER_CONSTANT за краями
+int border_index(int index, int count, BorderMode mode);
+
+// Заполнение halo значений слева и справа от строки row из width значений
+void border_fill_row(float* row, int width, int halo, Border border);
+
+// Преобразование формата хранения (на месте)
+bool image_convert(Image* image, PixelFormat format);
+
+// Переход к float-представлению; целочисленные форматы становятся PLANAR
+bool image_promote_float(Image* image);
+
+// Замена пикселей image пикселями src (src уничтожается)
+void image_take(Image* image, Image* src);
+
+// Копирование прямоугольной области между изображениями одного формата
+void image_copy_region(Image* dst, int dst_x, int dst_y,
+                       const Image* src, int src_x, int src_y,
+                       int width, int height);
+
+// Область изображения (координаты ограничиваются размерами image)
+ImageView image_view(const Image* image, int x, int y, int width, int height);
+
+// Перевод изображения на область view за O(1), без копирования.
+// Область MASK должна начинаться с границы байта (x кратно 8).
+bool image_apply_view(Image* image, ImageView view);
+
+// Размер пикселя в байтах (у MASK байт хранит 8 пикселей) и максимальное значение канала
+size_t pixel_format_size(PixelFormat format);
+int pixel_format_max(PixelFormat format);
+const char* pixel_format_name(PixelFormat format);
+
 // Получение и установка пикселей
 Color image_get_pixel(const Image* image, int x, int y);
 void image_set_pixel(Image* image, int x, int y, Color color);
@@ -0,0 +1,259 @@
+#include "integral.h"
+#include "parallel.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+// Столбцов в блоке прохода по столбцам: строки блока читаются подряд
+#define INTEGRAL_COLUMNS 256
+
+typedef struct {
+    const Image* image;
+    IntegralImage* integral;
+    atomic_bool failed;
+} IntegralContext;
+
+// Значения каналов строки y без перевода в [0, 1]; пиксель маски - 0 или 1 во всех каналах
+static void integral_load_row(const Image* image, int y, double* values[3]) {
+    int width = image->width;
+
+    if (image->format == PIXEL_FORMAT_PLANAR) {
+        for (int c = 0; c < 3; c++) {
+            const float* plane = image_plane_row(image, c, y);
+            for (int x = 0; x < width; x++) {
+                values[c][x] = plane[x];
+            }
+        }
+    } else if (image->format == PIXEL_FORMAT_U8) {
+        const Color8* pixels = (const Color8*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            values[0][x] = pixels[x].r;
+            values[1][x] = pixels[x].g;
+            values[2][x] = pixels[x].b;
+        }
+    } else if (image->format == PIXEL_FORMAT_U16) {
+        const Color16* pixels = (const Color16*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            values[0][x] = pixels[x].r;
+            values[1][x] = pixels[x].g;
+            values[2][x] = pixels[x].b;
+        }
+    } else if (image->format == PIXEL_FORMAT_MASK) {
+        const uint8_t* bits = image_mask_row(image, y);
+        for (int x = 0; x < width; x++) {
+            double value = (bits[x / 8] >> (7 - x % 8)) & 1;
+            values[0][x] = values[1][x] = values[2][x] = value;
+        }
+    } else {
+        const Color* pixels = (const Color*)image->data + (size_t)image->stride * y;
+        for (int x = 0; x < width; x++) {
+            values[0][x] = pixels[x].r;
+            values[1][x] = pixels[x].g;
+            values[2][x] = pixels[x].b;
+        }
+    }
+}
+
+// Строки [y_begin, y_end) изображения: суммы по строке (префиксы) в строки y + 1 таблицы
+static void integral_rows(void* context, int y_begin, int y_end) {
+    IntegralContext* ctx = (IntegralContext*)context;
+    IntegralImage* integral = ctx->integral;
+    int width = integral->width;
+
+    double* buffer = (double*)malloc(sizeof(double) * 3 * width);
+    if (!buffer) {
+        fprintf(stderr, "Error: Memory allocation failed for summed-area table\n");
+        atomic_store(&ctx->failed, true);
+        return;
+    }
+
+    double* values[3] = {buffer, buffer + width, buffer + 2 * width};
+
+    for (int y = y_begin; y < y_end; y++) {
+        integral_load_row(ctx->image, y, values);
+        size_t offset = integral->stride * (y + 1);
+
+        for (int c = 0; c < 3; c++) {
+            double* sum = integral->sum[c] + offset;
+            double running = 0.0;
+
+            sum[0] = 0.0;
+            for (int x = 0; x < width; x++) {
+                running += values[c][x];
+                sum[x + 1] = running;
+            }
+
+            if (integral->sum_squares[c]) {
+                double* squares = integral->sum_squares[c] + offset;
+                running = 0.0;
+
+                squares[0] = 0.0;
+                for (int x = 0; x < width; x++) {
+                    running += values[c][x] * values[c][x];
+                    squares[x + 1] = running;
+                }
+            }
+        }
+    }
+
+    free(buffer);
+}
+
+// Накопление префиксов строк сверху вниз в столбцах [x_begin, x_end) таблицы
+static void integral_accumulate(double* table, size_t stride, int height, int x_begin, int x_end) {
+    for (int y = 1; y <= height; y++) {
+        const double* above = table + stride * (y - 1);
+        double* row = table + stride * y;
+
+        for (int x = x_begin; x < x_end; x++) {
+            row[x] += above[x];
+        }
+    }
+}
+
+// Блоки столбцов [block_begin, block_end) таблицы
+static void integral_columns(void* context, int block_begin, int block_end) {
+    IntegralImage* integral = ((IntegralContext*)context)->integral;
+    int columns = integral->width + 1;
+
+    for (int block = block_begin; block < block_end; block++) {
+        int x_begin = block * INTEGRAL_COLUMNS;
+        int x_end = x_begin + INTEGRAL_COLUMNS < columns ? x_begin + INTEGRAL_COLUMNS : columns;
+
+        for (int c = 0; c < 3; c++) {
+            integral_accumulate(integral->sum[c], integral->stride, integral->height, x_begin, x_end);
+            if (integral->sum_squares[c]) {
+                integral_accumulate(integral->sum_squares[c], integral->stride, integral->height,
+                                    x_begin, x_end);
+            }
+        }
+    }
+}
+
+IntegralImage* integral_create(const Image* image, bool squares) {
+    if (!image || image->width <= 0 || image->height <= 0) {
+        fprintf(stderr, "Error: Cannot build summed-area table (invalid image)\n");
+        return NULL;
+    }
+
+    IntegralImage* integral = (IntegralImage*)calloc(1, sizeof(IntegralImage));
+    if (!integral) {
+        fprintf(stderr, "Error: Memory allocation failed for summed-area table\n");
+        return NULL;
+    }
+
+    integral->width = image->width;
+    integral->height = image->height;
+    integral->stride = (size_t)image->width + 1;
+    integral->scale = 1.0 / pixel_format_max(image->format);
+
+    size_t plane = integral->stride * ((size_t)image->height + 1);
+    int tables = squares ? 6 : 3;
+
+    integral->buffer = (double*)malloc(sizeof(double) * plane * tables);
+    if (!integral->buffer) {
+        fprintf(stderr, "Error: Memory allocation failed for %dx%d summed-area table\n",
+                image->width, image->height);
+        free(integral);
+        return NULL;
+    }
+
+    for (int c = 0; c < 3; c++) {
+        integral->sum[c] = integral->buffer + plane * c;
+        integral->sum_squares[c] = squares ? integral->buffer + plane * (3 + c) : NULL;
+
+        // Нулевая верхняя строка; нулевой левый столбец заполняет проход по строкам
+        for (size_t x = 0; x < integral->stride; x++) {
+            integral->sum[c][x] = 0.0;
+            if (squares) {
+                integral->sum_squares[c][x] = 0.0;
+            }
+        }
+    }
+
+    IntegralContext context;
+    context.image = image;
+    context.integral = integral;
+    atomic_init(&context.failed, false);
+
+    // Строки, не построенные из-за нехватки памяти, оставили бы в таблице мусор
+    parallel_for_rows(image->height, integral_rows, &context);
+    if (atomic_load(&context.failed)) {
+        integral_destroy(integral);
+        return NULL;
+    }
+
+    int blocks = (image->width + 1 + INTEGRAL_COLUMNS - 1) / INTEGRAL_COLUMNS;
+    parallel_for_rows(blocks, integral_columns, &context);
+
+    return integral;
+}
+
+void integral_destroy(IntegralImage* integral) {
+    if (!integral) {
+        return;
+    }
+
+    free(integral->buffer);
+    free(integral);
+}
+
+// Ограничение области размерами таблицы; false, если область пуста
+static bool integral_clip(const IntegralImage* integral, int* x0, int* y0, int* x1, int* y1) {
+    if (*x0 < 0) *x0 = 0;
+    if (*y0 < 0) *y0 = 0;
+    if (*x1 > integral->width) *x1 = integral->width;
+    if (*y1 > integral->height) *y1 = integral->height;
+
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+// Сумма по области таблицы: четыре обращения независимо от размера области
+static double integral_region(const IntegralImage* integral, const double* table,
+                              int x0, int y0, int x1, int y1) {
+    const double* top = table + integral->stride * y0;
+    const double* bottom = table + integral->stride * y1;
+    return bottom[x1] - bottom[x0] - top[x1] + top[x0];
+}
+
+double integral_sum(const IntegralImage* integral, int c, int x0, int y0, int x1, int y1) {
+    if (!integral || c < 0 || c > 2 || !integral_clip(integral, &x0, &y0, &x1, &y1)) {
+        return 0.0;
+    }
+
+    return integral_region(integral, integral->sum[c], x0, y0, x1, y1) * integral->scale;
+}
+
+double integral_sum_squares(const IntegralImage* integral, int c, int x0, int y0, int x1, int y1) {
+    if (!integral || c < 0 || c > 2 || !integral->sum_squares[c] ||
+        !integral_clip(integral, &x0, &y0, &x1, &y1)) {
+        return 0.0;
+    }
+
+    return integral_region(integral, integral->sum_squares[c], x0, y0, x1, y1) *
+           integral->scale * integral->scale;
+}
+
+bool integral_mean_variance(const IntegralImage* integral, int c, int x0, int y0, int x1, int y1,
+                            double* mean, double* variance) {
+    if (!integral || c < 0 || c > 2 || (variance && !integral->sum_squares[c]) ||
+        !integral_clip(integral, &x0, &y0, &x1, &y1)) {
+        return false;
+    }
+
+    double count = (double)(x1 - x0) * (y1 - y0);
+    double average = integral_region(integral, integral->sum[c], x0, y0, x1, y1) / count;
+
+    if (mean) {
+        *mean = average * integral->scale;
+    }
+
+    if (variance) {
+        // E[v^2] - E[v]^2; для целочисленных форматов суммы точны
+        double squares = integral_region(integral, integral->sum_squares[c], x0, y0, x1, y1) / count;
+        double value = squares - average * average;
+        *variance = (value > 0 ? value : 0.0) * integral->scale * integral->scale;
+    }
+
+    return true;
+}
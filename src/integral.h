@@ -0,0 +1,39 @@
+#ifndef INTEGRAL_H
+#define INTEGRAL_H
+
+#include "image.h"
+
+// Таблица сумм по областям (summed-area table): для каждого канала хранится
+// сумма значений прямоугольника [0, x) x [0, y), поэтому сумма, среднее и
+// дисперсия любой прямоугольной области считаются за O(1).
+// Значения целочисленных форматов суммируются без перевода в [0, 1], пиксель
+// маски - 0 или 1 во всех каналах. Суммы в double точны, пока не превышают
+// 2^53 (для U8 это изображения до ~10^8 пикселей с квадратами). Таблица
+// занимает 24 байта на пиксель, с квадратами - 48.
+typedef struct {
+    int width;
+    int height;
+    size_t stride;            // Шаг строки таблицы (width + 1)
+    double scale;             // Множитель значений до диапазона [0, 1]
+    double* sum[3];           // Суммы каналов, (width + 1) x (height + 1)
+    double* sum_squares[3];   // Суммы квадратов или NULL
+    double* buffer;
+} IntegralImage;
+
+// Построение таблицы за один параллельный проход по строкам и один по
+// столбцам; squares - вычислять также суммы квадратов (для дисперсии).
+// NULL при ошибке (сообщение выводится).
+IntegralImage* integral_create(const Image* image, bool squares);
+void integral_destroy(IntegralImage* integral);
+
+// Сумма канала c (в единицах [0, 1]) по области [x0, x1) x [y0, y1).
+// Область ограничивается размерами изображения; пустая область дает 0.
+double integral_sum(const IntegralImage* integral, int c, int x0, int y0, int x1, int y1);
+double integral_sum_squares(const IntegralImage* integral, int c, int x0, int y0, int x1, int y1);
+
+// Среднее и дисперсия канала c по области. Дисперсия требует сумм
+// квадратов (variance может быть NULL). false для пустой области.
+bool integral_mean_variance(const IntegralImage* integral, int c, int x0, int y0, int x1, int y1,
+                            double* mean, double* variance);
+
+#endif // INTEGRAL_H
@@ -5,6 +5,10 @@
 #include "bmp.h"
 #include "cli.h"
 #include "pipeline.h"
+#include "optimizer.h"
+#include "stream.h"
+#include "parallel.h"
+#include "profile.h"
 
 int main(int argc, char** argv) {
     printf("╔══════════════════════════════════════════════════════════╗\n");
@@ -37,14 +41,82 @@ int main(int argc, char** argv) {
     // Проверка формата входного файла
     if (!bmp_is_valid_format(args->input_file)) {
         fprintf(stderr, "❌ ОШИБКА: Файл '%s' не является валидным BMP файлом\n", args->input_file);
-        fprintf(stderr, "   Поддерживаются только 24-битные BMP без сжатия\n");
+        fprintf(stderr, "   Поддерживаются только 24-битные и 1-битные BMP без сжатия\n");
         cli_free_args(args);
         return EXIT_FAILURE;
     }
 
+    // Фильтры делят строки изображения между потоками
+    parallel_set_threads(args->threads);
+    atexit(parallel_shutdown);
+    printf("🧵 Потоков обработки: %d\n", parallel_get_threads());
+
+    // Продолжение за краями задается для всех фильтров сразу
+    filters_set_border(args->border);
+
+    // Замеры этапов: чтение, шаги пайплайна, запись
+    profile_enable(args->profile);
+
+    // Перезапись цепочки фильтров зависит от размеров изображения и
+    // продолжения за краями (ореолы), поэтому выполняется после них
+    int input_width = 0, input_height = 0;
+    bool has_info = bmp_get_info(args->input_file, &input_width, &input_height);
+    if (has_info) {
+        pipeline_optimize(args->pipeline, input_width, input_height, args->optimize, args->explain);
+    }
+
+    // Потоковый режим: чтение, фильтры и запись идут полосами строк.
+    // С -mmap строки тоже декодируются из отображения по мере обработки.
+    // Если фильтрам нужно все изображение сразу или полосы изменили бы
+    // результат, оно обрабатывается целиком.
+    bool streaming = false;
+    if (args->streaming || args->use_mmap) {
+        streaming = pipeline_can_stream(args->pipeline);
+        if (!streaming) {
+            printf("ℹ️  Фильтрам нужно все изображение: %s декодирует его целиком\n",
+                   args->streaming ? "-stream" : "-mmap");
+        }
+    }
+
+    if (streaming) {
+        printf("📁 Потоковая обработка: %s -> %s\n", args->input_file, args->output_file);
+        if (!pipeline_apply_stream(args->pipeline, args->input_file, args->output_file)) {
+            fprintf(stderr, "❌ ОШИБКА: Потоковая обработка '%s' не удалась\n", args->input_file);
+            cli_free_args(args);
+            return EXIT_FAILURE;
+        }
+
+        bool reported = profile_report(args->profile_file);
+        cli_free_args(args);
+        if (!reported) {
+            return EXIT_FAILURE;
+        }
+
+        printf("\n🎉 УСПЕХ! Обработка завершена.\n");
+        printf("   Результат сохранен в указанный файл.\n\n");
+        return EXIT_SUCCESS;
+    }
+
     // Чтение изображения
     printf("📁 Чтение изображения: %s\n", args->input_file);
-    Image* image = bmp_read(args->input_file);
+    // Начальная обрезка выполняется при чтении: читаются только нужные строки и столбцы
+    CropParams region = {0};
+    bool has_region = has_info &&
+                      pipeline_take_input_region(args->pipeline, input_width, input_height, &region);
+
+    int decode_stage = profile_stage("decode");
+    ProfileMark mark;
+    profile_begin(&mark);
+
+    Image* image;
+    if (has_region) {
+        image = args->use_mmap ?
+                bmp_read_mapped_region(args->input_file, region.x, region.y, region.width, region.height) :
+                bmp_read_region(args->input_file, region.x, region.y, region.width, region.height);
+    } else {
+        image = args->use_mmap ? bmp_read_mapped(args->input_file)
+                               : bmp_read(args->input_file);
+    }
     if (!image) {
         fprintf(stderr, "❌ ОШИБКА: Не удалось прочитать изображение из '%s'\n", args->input_file);
         fprintf(stderr, "   Проверьте наличие файла и его формат\n");
@@ -52,18 +124,27 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
+    profile_record(decode_stage, &mark, (long long)image->width * image->height);
     printf("✅ Изображение загружено: %d x %d пикселей\n", image->width, image->height);
 
     // Применение фильтров
     if (args->pipeline->count > 0) {
         printf("\n🔧 Применение фильтров...\n");
-        pipeline_apply(args->pipeline, image);
+        if (!pipeline_apply(args->pipeline, image)) {
+            fprintf(stderr, "❌ ОШИБКА: Не удалось применить фильтры к '%s'\n", args->input_file);
+            image_destroy(image);
+            cli_free_args(args);
+            return EXIT_FAILURE;
+        }
     } else {
         printf("\nℹ️  Фильтры не указаны, сохраняю исходное изображение\n");
     }
 
     // Сохранение изображения
     printf("💾 Сохранение изображения: %s\n", args->output_file);
+    int encode_stage = profile_stage("encode");
+    profile_begin(&mark);
+
     if (!bmp_write(args->output_file, image)) {
         fprintf(stderr, "❌ ОШИБКА: Не удалось сохранить изображение в '%s'\n", args->output_file);
         fprintf(stderr, "   Проверьте права доступа и свободное место на диске\n");
@@ -72,9 +153,15 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
+    profile_record(encode_stage, &mark, (long long)image->width * image->height);
+
     // Очистка
     image_destroy(image);
+    bool reported = profile_report(args->profile_file);
     cli_free_args(args);
+    if (!reported) {
+        return EXIT_FAILURE;
+    }
 
     printf("\n🎉 УСПЕХ! Обработка завершена.\n");
     printf("   Результат сохранен в указанный файл.\n\n");
@@ -0,0 +1,455 @@
+#include "optimizer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+// Размеры и формат изображения перед фильтром
+typedef struct {
+    int width;
+    int height;
+    PixelFormat format;
+} PlanShape;
+
+// Цепочка фильтров в виде массива на время перезаписи
+typedef struct {
+    FilterNode** nodes;
+    int count;
+    int capacity;
+    PlanShape* shapes;      // shapes[i] - вход фильтра i, shapes[count] - результат
+    OptimizeLevel level;
+    bool explain;
+} Plan;
+
+static bool format_is_integer(PixelFormat format) {
+    return format == PIXEL_FORMAT_U8 || format == PIXEL_FORMAT_U16;
+}
+
+static bool plan_is_crop(const FilterNode* node) {
+    return node->function == filter_crop;
+}
+
+// Область обрезки на изображении width x height, ограниченная так же,
+// как в filter_crop; false, если обрезка ошибочна и ничего не меняет
+static bool plan_crop_region(const FilterNode* node, int width, int height, CropParams* region) {
+    const CropParams* crop = (const CropParams*)node->params;
+
+    if (!crop || crop->x < 0 || crop->y < 0 || crop->x >= width || crop->y >= height ||
+        crop->width <= 0 || crop->height <= 0) {
+        return false;
+    }
+
+    region->x = crop->x;
+    region->y = crop->y;
+    region->width = crop->width < width - crop->x ? crop->width : width - crop->x;
+    region->height = crop->height < height - crop->y ? crop->height : height - crop->y;
+    return true;
+}
+
+// Размеры и формат после фильтра, включая перевод в U8 перед фильтром,
+// если он не принимает формат (как pipeline_apply). Ошибочные фильтры
+// могут не сменить формат на float или маску - правила, требующие
+// целочисленного формата, тогда лишь не применяются.
+static PlanShape plan_step(const FilterNode* node, PlanShape shape) {
+    const FilterDescriptor* descriptor = node->descriptor;
+
+    if (!(descriptor->formats & FILTER_FORMAT(shape.format))) {
+        shape.format = PIXEL_FORMAT_U8;
+    }
+
+    CropParams region;
+    if (plan_is_crop(node) && plan_crop_region(node, shape.width, shape.height, &region)) {
+        shape.width = region.width;
+        shape.height = region.height;
+    }
+
+    if (descriptor->flags & FILTER_MASK) {
+        shape.format = PIXEL_FORMAT_MASK;
+    } else if ((descriptor->flags & FILTER_FLOAT) && shape.format != PIXEL_FORMAT_FLOAT) {
+        shape.format = PIXEL_FORMAT_PLANAR;
+    }
+
+    return shape;
+}
+
+static void plan_update(Plan* plan) {
+    for (int i = 0; i < plan->count; i++) {
+        plan->shapes[i + 1] = plan_step(plan->nodes[i], plan->shapes[i]);
+    }
+}
+
+// Оценка стоимости фильтра index в миллионах операций
+static double plan_node_cost(const Plan* plan, int index) {
+    const PlanShape* shape = &plan->shapes[index];
+    return pipeline_filter_cost(plan->nodes[index]) * 3.0 * shape->width * shape->height / 1e6;
+}
+
+static double plan_cost(const Plan* plan) {
+    double cost = 0.0;
+    for (int i = 0; i < plan->count; i++) {
+        cost += plan_node_cost(plan, i);
+    }
+    return cost;
+}
+
+// Имя фильтра с параметрами
+static void plan_describe(const FilterNode* node, char* text, size_t size) {
+    char params[96] = "";
+    if (node->descriptor->describe && node->params) {
+        node->descriptor->describe(node->params, params, sizeof(params));
+    }
+
+    snprintf(text, size, "%s%s%s", node->name, params[0] ? " " : "", params);
+}
+
+static void plan_print(const Plan* plan, const char* title) {
+    printf("%s: %d filter(s), estimated %.1f M operations\n", title, plan->count, plan_cost(plan));
+
+    for (int i = 0; i < plan->count; i++) {
+        char text[128];
+        plan_describe(plan->nodes[i], text, sizeof(text));
+        printf("  %2d. %-40s %dx%d, %.1f M\n", i + 1, text,
+               plan->shapes[i].width, plan->shapes[i].height, plan_node_cost(plan, i));
+    }
+}
+
+// Описание перезаписи для -explain
+static void plan_note(const Plan* plan, const char* format, ...) {
+    if (!plan->explain) {
+        return;
+    }
+
+    va_list list;
+    va_start(list, format);
+    printf("  * ");
+    vprintf(format, list);
+    printf("\n");
+    va_end(list);
+}
+
+static FilterNode* plan_node_create(const FilterNode* model, void* params) {
+    FilterNode* node = (FilterNode*)malloc(sizeof(FilterNode));
+    char* name = _strdup(model->name);
+
+    if (!node || !name) {
+        fprintf(stderr, "Error: Memory allocation failed for filter node\n");
+        free(node);
+        free(name);
+        return NULL;
+    }
+
+    node->function = model->function;
+    node->descriptor = model->descriptor;
+    node->params = params;
+    node->name = name;
+    node->next = NULL;
+    return node;
+}
+
+static void plan_node_destroy(FilterNode* node) {
+    free(node->params);
+    free(node->name);
+    free(node);
+}
+
+static void plan_remove(Plan* plan, int index) {
+    plan_node_destroy(plan->nodes[index]);
+    memmove(&plan->nodes[index], &plan->nodes[index + 1],
+            sizeof(FilterNode*) * (plan->count - index - 1));
+    plan->count--;
+}
+
+static void plan_insert(Plan* plan, int index, FilterNode* node) {
+    memmove(&plan->nodes[index + 1], &plan->nodes[index],
+            sizeof(FilterNode*) * (plan->count - index));
+    plan->nodes[index] = node;
+    plan->count++;
+}
+
+// Обрезка всего изображения ничего не меняет
+static bool optimize_full_crop(Plan* plan) {
+    for (int i = 0; i < plan->count; i++) {
+        const PlanShape* shape = &plan->shapes[i];
+        CropParams region;
+
+        if (plan_is_crop(plan->nodes[i]) &&
+            plan_crop_region(plan->nodes[i], shape->width, shape->height, &region) &&
+            region.x == 0 && region.y == 0 &&
+            region.width == shape->width && region.height == shape->height) {
+            plan_note(plan, "crop at %d covers the whole %dx%d image, removed",
+                      i + 1, shape->width, shape->height);
+            plan_remove(plan, i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Обрезки подряд складываются в одну
+static bool optimize_merge_crops(Plan* plan) {
+    for (int i = 0; i + 1 < plan->count; i++) {
+        const PlanShape* first = &plan->shapes[i];
+        const PlanShape* second = &plan->shapes[i + 1];
+        CropParams a, b;
+
+        if (!plan_is_crop(plan->nodes[i]) || !plan_is_crop(plan->nodes[i + 1]) ||
+            !plan_crop_region(plan->nodes[i], first->width, first->height, &a) ||
+            !plan_crop_region(plan->nodes[i + 1], second->width, second->height, &b)) {
+            continue;
+        }
+
+        CropParams* crop = (CropParams*)plan->nodes[i]->params;
+        crop->x = a.x + b.x;
+        crop->y = a.y + b.y;
+        crop->width = b.width;
+        crop->height = b.height;
+
+        plan_note(plan, "crops at %d and %d merged into %dx%d at (%d, %d)",
+                  i + 1, i + 2, crop->width, crop->height, crop->x, crop->y);
+        plan_remove(plan, i + 1);
+        return true;
+    }
+
+    return false;
+}
+
+// Ореол фильтра, если обрезку после него можно выполнить до него, иначе -1.
+// Фильтр не зависит от положения пикселя в изображении и от пикселей
+// дальше ореола (FilterDescriptor::finite), не меняет размеры и не строит
+// маску (иначе обрезка маски переводила бы ее в U8 в другом месте цепочки).
+// Приближенный ореол бесконечных фильтров допустим только в OPTIMIZE_FAST.
+static int optimize_crop_halo(const Plan* plan, const FilterNode* node) {
+    const FilterDescriptor* descriptor = node->descriptor;
+    int halo = 0;
+
+    if ((descriptor->flags & (FILTER_RESIZES | FILTER_POSITIONAL | FILTER_GLOBAL | FILTER_MASK)) ||
+        !pipeline_filter_halo(node, &halo) ||
+        (descriptor->check && !descriptor->check(node->params)) ||
+        (plan->level != OPTIMIZE_FAST && descriptor->finite && !descriptor->finite(node->params))) {
+        return -1;
+    }
+
+    return halo;
+}
+
+// Перенос обрезки перед фильтрами, от которых ее результат не зависит:
+// они выполняются на области, расширенной на их суммарный ореол, а
+// оставшаяся на месте обрезка отрезает ореол. Как и у плиток, пиксели
+// области не меняются: у краев расширенной области, кроме краев
+// изображения, ошибки не доходят до отрезаемой части.
+static bool optimize_push_crop(Plan* plan) {
+    for (int i = 1; i < plan->count && plan->count < plan->capacity; i++) {
+        const PlanShape* shape = &plan->shapes[i];
+        CropParams region;
+
+        if (!plan_is_crop(plan->nodes[i]) ||
+            !plan_crop_region(plan->nodes[i], shape->width, shape->height, &region)) {
+            continue;
+        }
+
+        int first = i;
+        int halo = 0;
+        for (int h; first > 0 && (h = optimize_crop_halo(plan, plan->nodes[first - 1])) >= 0; first--) {
+            halo += h;
+        }
+
+        if (first == i) {
+            continue;
+        }
+
+        int x0 = region.x - halo > 0 ? region.x - halo : 0;
+        int y0 = region.y - halo > 0 ? region.y - halo : 0;
+        int x1 = region.x + region.width + halo < shape->width ? region.x + region.width + halo : shape->width;
+        int y1 = region.y + region.height + halo < shape->height ? region.y + region.height + halo : shape->height;
+
+        // Расширенная область - все изображение: переносить нечего
+        if (x1 - x0 == shape->width && y1 - y0 == shape->height) {
+            continue;
+        }
+
+        CropParams* outer = (CropParams*)malloc(sizeof(CropParams));
+        FilterNode* node = outer ? plan_node_create(plan->nodes[i], outer) : NULL;
+        if (!node) {
+            free(outer);
+            return false;
+        }
+
+        outer->x = x0;
+        outer->y = y0;
+        outer->width = x1 - x0;
+        outer->height = y1 - y0;
+
+        // Обрезка на месте становится областью внутри расширенной; если ореола
+        // нет, она совпадает с изображением и удаляется следующим правилом
+        CropParams* inner = (CropParams*)plan->nodes[i]->params;
+        inner->x = region.x - x0;
+        inner->y = region.y - y0;
+        inner->width = region.width;
+        inner->height = region.height;
+
+        plan_note(plan, "crop at %d moved before %d filter(s) as %dx%d at (%d, %d), halo %d",
+                  i + 1, i - first, outer->width, outer->height, outer->x, outer->y, halo);
+        plan_insert(plan, first, node);
+        return true;
+    }
+
+    return false;
+}
+
+// Повторы фильтров FILTER_INVOLUTION и FILTER_IDEMPOTENT на целочисленном изображении
+static bool optimize_repeats(Plan* plan) {
+    for (int i = 0; i + 1 < plan->count; i++) {
+        const FilterDescriptor* descriptor = plan->nodes[i]->descriptor;
+
+        if (descriptor != plan->nodes[i + 1]->descriptor ||
+            !format_is_integer(plan->shapes[i].format)) {
+            continue;
+        }
+
+        if (descriptor->flags & FILTER_INVOLUTION) {
+            plan_note(plan, "%s at %d and %d cancel out", descriptor->name, i + 1, i + 2);
+            plan_remove(plan, i + 1);
+            plan_remove(plan, i);
+            return true;
+        }
+
+        if (descriptor->flags & FILTER_IDEMPOTENT) {
+            plan_note(plan, "repeated %s at %d removed", descriptor->name, i + 2);
+            plan_remove(plan, i + 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Приближенное объединение соседних фильтров (FilterDescriptor::merge),
+// если оценка стоимости не растет
+static bool optimize_merge(Plan* plan) {
+    for (int i = 0; i + 1 < plan->count; i++) {
+        FilterNode* a = plan->nodes[i];
+        FilterNode* b = plan->nodes[i + 1];
+        const FilterDescriptor* descriptor = a->descriptor;
+
+        if (descriptor != b->descriptor || !descriptor->merge) {
+            continue;
+        }
+
+        void* params = descriptor->merge(a->params, b->params);
+        FilterNode* node = params ? plan_node_create(a, params) : NULL;
+        if (!node) {
+            free(params);
+            continue;
+        }
+
+        if (pipeline_filter_cost(node) > pipeline_filter_cost(a) + pipeline_filter_cost(b)) {
+            plan_node_destroy(node);
+            continue;
+        }
+
+        if (plan->explain) {
+            char first[128], second[128], merged[128];
+            plan_describe(a, first, sizeof(first));
+            plan_describe(b, second, sizeof(second));
+            plan_describe(node, merged, sizeof(merged));
+            plan_note(plan, "%s and %s at %d merged into %s (approximate)", first, second, i + 1, merged);
+        }
+
+        plan_remove(plan, i + 1);
+        plan_node_destroy(a);
+        plan->nodes[i] = node;
+        return true;
+    }
+
+    return false;
+}
+
+int pipeline_optimize(FilterPipeline* pipeline, int width, int height,
+                      OptimizeLevel level, bool explain) {
+    if (!pipeline || !pipeline->head || width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    // Свойства незарегистрированных фильтров неизвестны
+    for (const FilterNode* node = pipeline->head; node; node = node->next) {
+        if (!node->descriptor) {
+            if (explain) {
+                printf("Filter '%s' is not registered, pipeline is not optimized\n", node->name);
+            }
+            return 0;
+        }
+    }
+
+    // Перенос обрезки добавляет по одному фильтру
+    Plan plan;
+    plan.count = 0;
+    plan.capacity = 2 * pipeline->count + 8;
+    plan.level = level;
+    plan.explain = explain;
+    plan.nodes = (FilterNode**)malloc(sizeof(FilterNode*) * plan.capacity);
+    plan.shapes = (PlanShape*)malloc(sizeof(PlanShape) * (plan.capacity + 1));
+
+    if (!plan.nodes || !plan.shapes) {
+        fprintf(stderr, "Error: Memory allocation failed for pipeline optimizer\n");
+        free(plan.nodes);
+        free(plan.shapes);
+        return 0;
+    }
+
+    for (FilterNode* node = pipeline->head; node; node = node->next) {
+        plan.nodes[plan.count++] = node;
+    }
+
+    plan.shapes[0].width = width;
+    plan.shapes[0].height = height;
+    plan.shapes[0].format = PIXEL_FORMAT_U8;
+    plan_update(&plan);
+
+    int count = plan.count;
+    double cost = plan_cost(&plan);
+
+    if (explain) {
+        printf("\nPipeline plan for %dx%d image\n", width, height);
+        plan_print(&plan, "Requested");
+    }
+
+    // Правила применяются по одному, пока какое-то из них меняет цепочку
+    int rewrites = 0;
+    for (int guard = 16 * plan.capacity; level != OPTIMIZE_OFF && guard > 0; guard--) {
+        bool changed = optimize_full_crop(&plan) || optimize_merge_crops(&plan) ||
+                       optimize_push_crop(&plan) || optimize_repeats(&plan) ||
+                       (level == OPTIMIZE_FAST && optimize_merge(&plan));
+        if (!changed) {
+            break;
+        }
+
+        plan_update(&plan);
+        rewrites++;
+    }
+
+    pipeline->head = plan.count > 0 ? plan.nodes[0] : NULL;
+    pipeline->tail = plan.count > 0 ? plan.nodes[plan.count - 1] : NULL;
+    pipeline->count = plan.count;
+    for (int i = 0; i < plan.count; i++) {
+        plan.nodes[i]->next = i + 1 < plan.count ? plan.nodes[i + 1] : NULL;
+    }
+
+    if (explain) {
+        if (rewrites > 0) {
+            plan_print(&plan, "Optimized");
+        } else {
+            printf("No rewrites apply%s\n", level == OPTIMIZE_OFF ? " (optimizer is off)" : "");
+        }
+        printf("\n");
+    }
+
+    if (rewrites > 0) {
+        printf("Optimizer: %d filter(s) -> %d, estimated %.1f -> %.1f M operations\n",
+               count, plan.count, cost, plan_cost(&plan));
+    }
+
+    free(plan.nodes);
+    free(plan.shapes);
+    return rewrites;
+}
@@ -0,0 +1,38 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "pipeline.h"
+
+// Уровень оптимизации цепочки фильтров
+typedef enum {
+    OPTIMIZE_OFF,       // Фильтры выполняются в заданном порядке
+    OPTIMIZE_EXACT,     // Только перезаписи, не меняющие результат (по умолчанию)
+    OPTIMIZE_FAST       // Также приближенные: слияние гауссовых размытий
+} OptimizeLevel;
+
+// Перезапись пайплайна для изображения width x height в более дешевую
+// цепочку. Точные правила (OPTIMIZE_EXACT) не меняют ни одного пикселя
+// результата и формат выходного файла:
+//  - обрезка всего изображения удаляется, обрезки подряд складываются;
+//  - обрезка переносится перед фильтрами без зависимости от положения
+//    пикселя (не виньетка), с известным точным ореолом (не Canny, не
+//    BORDER_WRAP, не рекурсивное размытие) и не строящими маску.
+//    Перенесенная область расширяется на суммарный ореол этих фильтров,
+//    лишнее отрезается после них, как у плиток;
+//  - FILTER_INVOLUTION дважды подряд (негатив) удаляются, FILTER_IDEMPOTENT
+//    дважды подряд (grayscale) выполняется один раз - только если
+//    изображение перед ними в целочисленном формате (U8, U16): во float
+//    1 - (1 - v) может отличаться от v в последнем бите.
+// OPTIMIZE_FAST добавляет объединение соседних фильтров через
+// FilterDescriptor::merge (гауссовы размытия складываются по дисперсии),
+// если оценка стоимости не растет, и перенос обрезки через рекурсивное
+// размытие. Результат отличается в пределах
+// погрешности усечения ядра и у краев изображения.
+// Ошибочные фильтры (обрезка за пределами изображения, неверные
+// параметры) не переносятся и не объединяются, чтобы сообщить об ошибке.
+// explain - вывод исходного и выбранного плана с оценками стоимости.
+// Возвращает число выполненных перезаписей.
+int pipeline_optimize(FilterPipeline* pipeline, int width, int height,
+                      OptimizeLevel level, bool explain);
+
+#endif // OPTIMIZER_H
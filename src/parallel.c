@@ -0,0 +1,256 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "parallel.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE thread_t;
+typedef CRITICAL_SECTION mutex_t;
+typedef CONDITION_VARIABLE cond_t;
+
+#define mutex_init(m)      InitializeCriticalSection(m)
+#define mutex_destroy(m)   DeleteCriticalSection(m)
+#define mutex_lock(m)      EnterCriticalSection(m)
+#define mutex_unlock(m)    LeaveCriticalSection(m)
+#define cond_init(c)       InitializeConditionVariable(c)
+#define cond_destroy(c)    ((void)(c))
+#define cond_wait(c, m)    SleepConditionVariableCS(c, m, INFINITE)
+#define cond_broadcast(c)  WakeAllConditionVariable(c)
+#define cond_signal(c)     WakeConditionVariable(c)
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t thread_t;
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+
+#define mutex_init(m)      pthread_mutex_init(m, NULL)
+#define mutex_destroy(m)   pthread_mutex_destroy(m)
+#define mutex_lock(m)      pthread_mutex_lock(m)
+#define mutex_unlock(m)    pthread_mutex_unlock(m)
+#define cond_init(c)       pthread_cond_init(c, NULL)
+#define cond_destroy(c)    pthread_cond_destroy(c)
+#define cond_wait(c, m)    pthread_cond_wait(c, m)
+#define cond_broadcast(c)  pthread_cond_broadcast(c)
+#define cond_signal(c)     pthread_cond_signal(c)
+#endif
+
+// Участков на поток: мелкие участки выравнивают нагрузку между потоками
+#define PARALLEL_CHUNKS_PER_THREAD 4
+
+typedef struct {
+    thread_t* threads;
+    int worker_count;        // Потоков пула (без вызывающего)
+    mutex_t mutex;
+    cond_t work_ready;
+    cond_t work_done;
+    unsigned generation;     // Номер текущего задания
+    int working;             // Потоков, еще не закончивших задание
+    bool shutdown;
+
+    // Текущее задание
+    ParallelRowsFunc func;
+    void* context;
+    int height;
+    int chunk;
+    atomic_int next_row;
+} ThreadPool;
+
+static ThreadPool* pool = NULL;
+static int requested_threads = 0;
+static atomic_bool pool_busy = false;
+
+static int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// Обработка участков текущего задания до их исчерпания
+static void run_chunks(ThreadPool* p) {
+    for (;;) {
+        int y = atomic_fetch_add(&p->next_row, p->chunk);
+        if (y >= p->height) {
+            break;
+        }
+
+        int end = y + p->chunk < p->height ? y + p->chunk : p->height;
+        p->func(p->context, y, end);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID arg) {
+#else
+static void* worker_main(void* arg) {
+#endif
+    ThreadPool* p = (ThreadPool*)arg;
+    unsigned seen = 0;
+
+    mutex_lock(&p->mutex);
+    for (;;) {
+        while (p->generation == seen && !p->shutdown) {
+            cond_wait(&p->work_ready, &p->mutex);
+        }
+
+        if (p->shutdown) {
+            break;
+        }
+
+        seen = p->generation;
+        mutex_unlock(&p->mutex);
+
+        run_chunks(p);
+
+        mutex_lock(&p->mutex);
+        if (--p->working == 0) {
+            cond_signal(&p->work_done);
+        }
+    }
+    mutex_unlock(&p->mutex);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static ThreadPool* pool_create(int thread_count) {
+    ThreadPool* p = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!p) {
+        return NULL;
+    }
+
+    p->threads = (thread_t*)calloc(thread_count, sizeof(thread_t));
+    if (!p->threads) {
+        free(p);
+        return NULL;
+    }
+
+    mutex_init(&p->mutex);
+    cond_init(&p->work_ready);
+    cond_init(&p->work_done);
+
+    for (int i = 0; i < thread_count; i++) {
+#ifdef _WIN32
+        p->threads[i] = CreateThread(NULL, 0, worker_main, p, 0, NULL);
+        bool started = p->threads[i] != NULL;
+#else
+        bool started = pthread_create(&p->threads[i], NULL, worker_main, p) == 0;
+#endif
+        if (!started) {
+            fprintf(stderr, "Warning: Started only %d of %d worker threads\n", i, thread_count);
+            break;
+        }
+        p->worker_count++;
+    }
+
+    return p;
+}
+
+void parallel_shutdown(void) {
+    if (!pool) {
+        return;
+    }
+
+    mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    cond_broadcast(&pool->work_ready);
+    mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->worker_count; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+
+    mutex_destroy(&pool->mutex);
+    cond_destroy(&pool->work_ready);
+    cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool);
+    pool = NULL;
+}
+
+void parallel_set_threads(int count) {
+    if (count < 0) {
+        count = 0;
+    }
+
+    if (count != requested_threads) {
+        parallel_shutdown();
+        requested_threads = count;
+    }
+}
+
+int parallel_get_threads(void) {
+    return requested_threads > 0 ? requested_threads : cpu_count();
+}
+
+void parallel_for_rows(int height, ParallelRowsFunc func, void* context) {
+    if (height <= 0 || !func) {
+        return;
+    }
+
+    int threads = parallel_get_threads();
+
+    // Один поток, одна строка или вложенный вызов - последовательно
+    bool expected = false;
+    if (threads <= 1 || height < 2 ||
+        !atomic_compare_exchange_strong(&pool_busy, &expected, true)) {
+        func(context, 0, height);
+        return;
+    }
+
+    if (!pool) {
+        pool = pool_create(threads - 1);
+    }
+
+    if (!pool || pool->worker_count == 0) {
+        func(context, 0, height);
+        atomic_store(&pool_busy, false);
+        return;
+    }
+
+    int chunks = (pool->worker_count + 1) * PARALLEL_CHUNKS_PER_THREAD;
+    int chunk = (height + chunks - 1) / chunks;
+
+    mutex_lock(&pool->mutex);
+    pool->func = func;
+    pool->context = context;
+    pool->height = height;
+    pool->chunk = chunk > 0 ? chunk : 1;
+    atomic_store(&pool->next_row, 0);
+    pool->working = pool->worker_count;
+    pool->generation++;
+    cond_broadcast(&pool->work_ready);
+    mutex_unlock(&pool->mutex);
+
+    // Вызывающий поток работает наравне с потоками пула
+    run_chunks(pool);
+
+    mutex_lock(&pool->mutex);
+    while (pool->working > 0) {
+        cond_wait(&pool->work_done, &pool->mutex);
+    }
+    mutex_unlock(&pool->mutex);
+
+    atomic_store(&pool_busy, false);
+}
@@ -0,0 +1,21 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// Обработка диапазона строк [y_begin, y_end)
+typedef void (*ParallelRowsFunc)(void* context, int y_begin, int y_end);
+
+// Число потоков обработки (0 - по числу ядер процессора)
+void parallel_set_threads(int count);
+int parallel_get_threads(void);
+
+// Разбиение строк [0, height) на участки и их обработка пулом потоков.
+// Вызывающий поток тоже обрабатывает участки; функция возвращается,
+// когда обработаны все строки. Вложенные вызовы выполняются последовательно.
+// Изображения, создаваемые внутри func, не используют пул буферов вызывающего
+// потока: активный пул у каждого потока свой.
+void parallel_for_rows(int height, ParallelRowsFunc func, void* context);
+
+// Остановка потоков пула
+void parallel_shutdown(void);
+
+#endif // PARALLEL_H
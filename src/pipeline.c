@@ -1,8 +1,14 @@
 #include "pipeline.h"
+#include "parallel.h"
+#include "profile.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 #include <stdio.h>
 
+// Наибольшее число поточечных фильтров в одном слитом проходе
+#define PIPELINE_MAX_FUSED 16
+
 FilterPipeline* pipeline_create(void) {
     FilterPipeline* pipeline = (FilterPipeline*)malloc(sizeof(FilterPipeline));
     if (pipeline) {
@@ -38,6 +44,7 @@ void pipeline_add_filter(FilterPipeline* pipeline,
     }
 
     node->function = function;
+    node->descriptor = filter_registry_find_function(function);
     node->params = params;
     node->next = NULL;
 
@@ -61,24 +68,406 @@ void pipeline_add_filter(FilterPipeline* pipeline,
     printf("Added filter: %s\n", node->name);
 }
 
-void pipeline_apply(FilterPipeline* pipeline, Image* image) {
+bool pipeline_filter_halo(const FilterNode* node, int* halo) {
+    *halo = 0;
+    return node->descriptor && node->descriptor->halo && node->descriptor->halo(node->params, halo);
+}
+
+float pipeline_filter_cost(const FilterNode* node) {
+    const FilterDescriptor* descriptor = node->descriptor;
+    return descriptor && descriptor->cost ? descriptor->cost(node->params) : 1.0f;
+}
+
+void pipeline_run_filter_at(const FilterNode* node, Image* image, int x, int y,
+                            int full_width, int full_height) {
+    if (node->descriptor && node->descriptor->apply_at) {
+        node->descriptor->apply_at(image, node->params, x, y, full_width, full_height);
+        return;
+    }
+
+    node->function(image, node->params);
+}
+
+// Шаг слитого прохода для поточечного фильтра; false, если фильтр не поточечный
+static bool pipeline_pointwise_step(const FilterNode* node, PointwiseStep* step) {
+    return node->descriptor && node->descriptor->pointwise &&
+           node->descriptor->pointwise(node->params, step);
+}
+
+// Серия поточечных фильтров (не длиннее limit), начинающаяся с node.
+// Возвращает ее длину, шаги записываются в steps.
+static int pipeline_pointwise_run(const FilterNode* node, int limit, PointwiseStep* steps) {
+    int count = 0;
+    if (limit > PIPELINE_MAX_FUSED) {
+        limit = PIPELINE_MAX_FUSED;
+    }
+
+    while (node && count < limit && pipeline_pointwise_step(node, &steps[count])) {
+        node = node->next;
+        count++;
+    }
+
+    return count;
+}
+
+// Плитка маски переводится в U8 перед каждым фильтром: ее область
+// сужается на ореолы, не кратные байту строки маски
+static bool pipeline_unmask(Image* image) {
+    return image->format != PIXEL_FORMAT_MASK || image_convert(image, PIXEL_FORMAT_U8);
+}
+
+// Перевод изображения в U8 (формат чтения BMP), если фильтр не принимает
+// его формат. Поиск границ принимает маску без преобразования.
+static bool pipeline_accept_format(Image* image, const FilterNode* node) {
+    unsigned formats = node->descriptor ? node->descriptor->formats : FILTER_FORMATS_COLOR;
+    return (formats & FILTER_FORMAT(image->format)) || image_convert(image, PIXEL_FORMAT_U8);
+}
+
+// Ореол фильтра, если его можно выполнять по плиткам, иначе -1.
+// Фильтры с ошибочными параметрами выполняются целиком, чтобы сообщить
+// об ошибке один раз, а не для каждой плитки. Бесконечные (рекурсивные)
+// фильтры тоже выполняются целиком: на плитке их ореол отсекает малые
+// вклады, и результат зависел бы от разбиения цепочки оптимизатором.
+static int pipeline_tile_halo(const FilterNode* node) {
+    const FilterDescriptor* descriptor = node->descriptor;
+    int halo = 0;
+
+    if (!pipeline_filter_halo(node, &halo) || (descriptor->flags & FILTER_RESIZES) ||
+        (descriptor->check && !descriptor->check(node->params)) ||
+        (descriptor->finite && !descriptor->finite(node->params))) {
+        return -1;
+    }
+
+    return halo;
+}
+
+typedef struct {
+    const FilterNode* first;
+    int count;               // Фильтров в цепочке
+    const Image* input;
+    Image* output;
+    int halo;                // Суммарный ореол цепочки
+    int tile;                // Сторона плитки без ореола
+    int tiles_x;
+    atomic_bool failed;
+    atomic_llong* filter_time;   // Время фильтров во всех потоках, нс (-profile), или NULL
+} TileContext;
+
+// Добавление ко времени фильтров [first, first + count) цепочки на плитках
+// замера с момента start; время слитой серии делится по оценкам стоимости
+static void tile_add_time(TileContext* ctx, const FilterNode* node, int first, int count,
+                          double start) {
+    double elapsed = (profile_time() - start) * 1e9;
+    float total = 0.0f;
+    const FilterNode* current = node;
+    for (int k = 0; k < count; k++, current = current->next) {
+        total += pipeline_filter_cost(current);
+    }
+
+    for (int k = 0; k < count; k++, node = node->next) {
+        double share = total > 0 ? pipeline_filter_cost(node) / total : 1.0 / count;
+        atomic_fetch_add(&ctx->filter_time[first + k], (long long)(elapsed * share));
+    }
+}
+
+// Выполнение цепочки на плитке index с ореолом; результат - часть плитки,
+// (*core_x, *core_y) - положение в ней точной части плитки
+static Image* tile_process(TileContext* ctx, int index, int* core_x, int* core_y) {
+    const Image* input = ctx->input;
+    int x0 = index % ctx->tiles_x * ctx->tile;
+    int y0 = index / ctx->tiles_x * ctx->tile;
+    int x1 = x0 + ctx->tile < input->width ? x0 + ctx->tile : input->width;
+    int y1 = y0 + ctx->tile < input->height ? y0 + ctx->tile : input->height;
+
+    // Ошибки у краев плитки, кроме краев изображения, распространяются
+    // каждым фильтром на его ореол. Фильтр выполняется на области плитки
+    // с ореолом его и следующих фильтров, поэтому до точной части ошибки
+    // не доходят, а область сужается от фильтра к фильтру.
+    int halo = ctx->halo;
+    int tile_x = x0 - halo > 0 ? x0 - halo : 0;
+    int tile_y = y0 - halo > 0 ? y0 - halo : 0;
+    int tile_x1 = x1 + halo < input->width ? x1 + halo : input->width;
+    int tile_y1 = y1 + halo < input->height ? y1 + halo : input->height;
+
+    Image* tile = image_create_format(tile_x1 - tile_x, tile_y1 - tile_y, input->format);
+    if (!tile) {
+        return NULL;
+    }
+
+    image_copy_region(tile, 0, 0, input, tile_x, tile_y, tile->width, tile->height);
+
+    const FilterNode* node = ctx->first;
+    for (int i = 0; i < ctx->count; ) {
+        if (!pipeline_unmask(tile)) {
+            image_destroy(tile);
+            return NULL;
+        }
+
+        int ax = x0 - halo > tile_x ? x0 - halo : tile_x;
+        int ay = y0 - halo > tile_y ? y0 - halo : tile_y;
+        int bx = x1 + halo < tile_x + tile->width ? x1 + halo : tile_x + tile->width;
+        int by = y1 + halo < tile_y + tile->height ? y1 + halo : tile_y + tile->height;
+
+        if (ax > tile_x || ay > tile_y || bx - ax < tile->width || by - ay < tile->height) {
+            image_apply_view(tile, image_view(tile, ax - tile_x, ay - tile_y, bx - ax, by - ay));
+            tile_x = ax;
+            tile_y = ay;
+        }
+
+        // Серия поточечных фильтров (без ореола) выполняется одним проходом
+        PointwiseStep steps[PIPELINE_MAX_FUSED];
+        int run = pipeline_pointwise_run(node, ctx->count - i, steps);
+        double start = ctx->filter_time ? profile_time() : 0.0;
+
+        if (run >= 2) {
+            apply_pointwise_chain(tile, steps, run, tile_x, tile_y, input->width, input->height);
+        } else {
+            pipeline_run_filter_at(node, tile, tile_x, tile_y, input->width, input->height);
+            halo -= pipeline_tile_halo(node);
+            run = 1;
+        }
+
+        if (ctx->filter_time) {
+            tile_add_time(ctx, node, i, run, start);
+        }
+
+        for (int k = 0; k < run; k++, i++) {
+            node = node->next;
+        }
+    }
+
+    *core_x = x0 - tile_x;
+    *core_y = y0 - tile_y;
+    return tile;
+}
+
+// Перенос точной части плитки index в результат
+static bool tile_store(TileContext* ctx, int index, Image* tile, int core_x, int core_y) {
+    Image* output = ctx->output;
+    int x0 = index % ctx->tiles_x * ctx->tile;
+    int y0 = index / ctx->tiles_x * ctx->tile;
+    int width = output->width - x0 < ctx->tile ? output->width - x0 : ctx->tile;
+    int height = output->height - y0 < ctx->tile ? output->height - y0 : ctx->tile;
+
+    if (tile->format != output->format) {
+        return false;
+    }
+
+    image_copy_region(output, x0, y0, tile, core_x, core_y, width, height);
+    return true;
+}
+
+// Плитки [begin, end), начиная со второй (первая выполняется заранее)
+static void tile_rows(void* context, int begin, int end) {
+    TileContext* ctx = (TileContext*)context;
+
+    // Временные буферы плиток переиспользуются в пределах участка
+    ImagePool* pool = image_pool_create();
+    ImagePool* previous_pool = image_pool_set_active(pool);
+
+    for (int i = begin + 1; i <= end && !atomic_load(&ctx->failed); i++) {
+        int core_x, core_y;
+        Image* tile = tile_process(ctx, i, &core_x, &core_y);
+
+        if (!tile || !tile_store(ctx, i, tile, core_x, core_y)) {
+            atomic_store(&ctx->failed, true);
+        }
+        image_destroy(tile);
+    }
+
+    image_pool_set_active(previous_pool);
+    image_pool_destroy(pool);
+}
+
+// Поплиточное выполнение цепочки из count фильтров: вся цепочка проходит
+// по плитке, пока та находится в кэше, вместо прохода каждого фильтра по
+// всему изображению. Плитки распределяются между потоками. Результат
+// совпадает с последовательным применением фильтров. filter_seconds (NULL
+// или count элементов) - время каждого фильтра, сложенное по плиткам и потокам.
+static bool pipeline_apply_tiled(const FilterNode* first, int count, int halo, Image* image,
+                                 double* filter_seconds) {
+    TileContext context;
+    context.first = first;
+    context.count = count;
+    context.input = image;
+    context.output = NULL;
+    context.halo = halo;
+
+    // Плитка не меньше удвоенного ореола, чтобы повторные вычисления были малы.
+    // Сторона кратна 8: плитки маски не делят байты строк.
+    context.tile = PIPELINE_TILE_SIZE > 2 * halo ? PIPELINE_TILE_SIZE : (2 * halo + 7) / 8 * 8;
+    context.tiles_x = (image->width + context.tile - 1) / context.tile;
+    atomic_init(&context.failed, false);
+    context.filter_time = NULL;
+
+    if (filter_seconds) {
+        context.filter_time = (atomic_llong*)malloc(sizeof(atomic_llong) * count);
+        for (int i = 0; context.filter_time && i < count; i++) {
+            atomic_init(&context.filter_time[i], 0);
+        }
+    }
+
+    int tiles_y = (image->height + context.tile - 1) / context.tile;
+    int tiles = context.tiles_x * tiles_y;
+
+    printf("Running %d filter(s) in %d tile(s) of %dx%d, halo %d\n",
+           count, tiles, context.tile, context.tile, halo);
+
+    filters_set_verbose(false);
+
+    // Первая плитка определяет формат результата
+    int core_x, core_y;
+    Image* tile = tile_process(&context, 0, &core_x, &core_y);
+    context.output = tile ? image_create_format(image->width, image->height, tile->format) : NULL;
+
+    bool success = context.output && tile_store(&context, 0, tile, core_x, core_y);
+    image_destroy(tile);
+
+    if (success) {
+        parallel_for_rows(tiles - 1, tile_rows, &context);
+        success = !atomic_load(&context.failed);
+    }
+
+    filters_set_verbose(true);
+
+    for (int i = 0; filter_seconds && i < count; i++) {
+        filter_seconds[i] = context.filter_time ? atomic_load(&context.filter_time[i]) * 1e-9 : 0.0;
+    }
+    free(context.filter_time);
+
+    if (!success) {
+        fprintf(stderr, "Warning: Tiled execution failed, applying filters one by one\n");
+        image_destroy(context.output);
+        return false;
+    }
+
+    image_take(image, context.output);
+    return true;
+}
+
+// Замер шага из count фильтров, начиная с first, для отчета -profile: каждый
+// фильтр - свой этап, время и память шага делятся между ними пропорционально
+// weights (NULL - оценкам стоимости). mode - способ выполнения шага или NULL.
+static void pipeline_profile_step(const ProfileMark* mark, const FilterNode* first, int count,
+                                  const double* weights, const char* mode, long long pixels) {
+    if (!profile_enabled()) {
+        return;
+    }
+
+    char (*names)[96] = malloc(sizeof(*names) * count);
+    const char** name_list = (const char**)malloc(sizeof(char*) * count);
+    double* costs = (double*)malloc(sizeof(double) * count);
+    if (!names || !name_list || !costs) {
+        fprintf(stderr, "Error: Memory allocation failed for profile stage\n");
+        free(names);
+        free(name_list);
+        free(costs);
+        return;
+    }
+
+    for (int i = 0; i < count; i++, first = first->next) {
+        snprintf(names[i], sizeof(names[i]), "%s%s", first->name, mode ? mode : "");
+        name_list[i] = names[i];
+        costs[i] = weights ? weights[i] : pipeline_filter_cost(first);
+    }
+
+    profile_record_split(mark, name_list, costs, count, pixels);
+    free(names);
+    free(name_list);
+    free(costs);
+}
+
+bool pipeline_apply(FilterPipeline* pipeline, Image* image) {
     if (!pipeline || !image) {
         fprintf(stderr, "Error: Cannot apply pipeline (NULL parameters)\n");
-        return;
+        return false;
     }
 
     if (pipeline->count == 0) {
         printf("No filters to apply\n");
-        return;
+        return true;
     }
 
     printf("\nApplying %d filter(s):\n", pipeline->count);
     printf("========================================\n");
 
+    // Временные буферы фильтров переиспользуются в пределах одного запуска
+    ImagePool* pool = image_pool_create();
+    ImagePool* previous_pool = image_pool_set_active(pool);
+
     FilterNode* current = pipeline->head;
     int filter_index = 1;
+    int untiled = 0;    // Фильтров, применяемых целиком после неудачи поплиточного выполнения
+    bool success = true;
 
     while (current) {
+        // Шаг - фильтр, слитая серия или цепочка на плитках - замеряется целиком,
+        // замер делится между его фильтрами
+        ProfileMark mark;
+        const FilterNode* step = current;
+        long long pixels = (long long)image->width * image->height;
+        profile_begin(&mark);
+
+        if (!pipeline_accept_format(image, current)) {
+            fprintf(stderr, "Error: Cannot convert image for filter %d/%d: %s, %d filter(s) not applied\n",
+                    filter_index, pipeline->count, current->name, pipeline->count - filter_index + 1);
+            success = false;
+            break;
+        }
+
+        // Цепочка из нескольких фильтров с известным ореолом выполняется по плиткам
+        int chain = 0;
+        int halo = 0;
+        for (const FilterNode* node = current;
+             untiled == 0 && node && pipeline_tile_halo(node) >= 0; node = node->next) {
+            halo += pipeline_tile_halo(node);
+            chain++;
+        }
+
+        // Серия поточечных фильтров выполняется одним проходом по изображению;
+        // если цепочка из нее и состоит, плитки ничего не добавляют
+        PointwiseStep steps[PIPELINE_MAX_FUSED];
+        int run = pipeline_pointwise_run(current, pipeline->count, steps);
+
+        if (chain >= 2 && chain > run &&
+            (image->width > PIPELINE_TILE_SIZE || image->height > PIPELINE_TILE_SIZE)) {
+            const FilterNode* node = current;
+            for (int i = 0; i < chain; i++, node = node->next) {
+                printf("Filter %d/%d: %s (halo %d)\n", filter_index + i, pipeline->count,
+                       node->name, pipeline_tile_halo(node));
+            }
+
+            double* filter_seconds = profile_enabled() ? (double*)malloc(sizeof(double) * chain) : NULL;
+            bool tiled = pipeline_apply_tiled(current, chain, halo, image, filter_seconds);
+
+            if (tiled) {
+                for (int i = 0; i < chain; i++) {
+                    current = current->next;
+                }
+                filter_index += chain;
+                pipeline_profile_step(&mark, step, chain, filter_seconds, " (tiled)", pixels);
+            }
+
+            free(filter_seconds);
+            if (tiled) {
+                continue;
+            }
+
+            untiled = chain;
+        }
+
+        if (run >= 2) {
+            for (int i = 0; i < run; i++, current = current->next) {
+                printf("Filter %d/%d: %s\n", filter_index++, pipeline->count, current->name);
+            }
+
+            printf("Fusing %d pointwise filter(s) into one pass\n", run);
+            apply_pointwise_chain(image, steps, run, 0, 0, image->width, image->height);
+            untiled = untiled > run ? untiled - run : 0;
+            pipeline_profile_step(&mark, step, run, NULL, " (fused)", pixels);
+            continue;
+        }
+
         printf("Filter %d/%d: %s\n", filter_index++, pipeline->count, current->name);
 
         // Применяем фильтр
@@ -89,10 +478,89 @@ void pipeline_apply(FilterPipeline* pipeline, Image* image) {
         }
 
         current = current->next;
+        if (untiled > 0) {
+            untiled--;
+        }
+
+        pipeline_profile_step(&mark, step, 1, NULL, NULL, pixels);
+    }
+
+    image_pool_set_active(previous_pool);
+
+    if (pool) {
+        // Статистика пула - диагностика памяти, вместе с отчетом -profile
+        if (profile_enabled()) {
+            ImagePoolStats stats = image_pool_get_stats(pool);
+            printf("Scratch buffers: %d allocated (%.1f MB), %d reused\n",
+                   stats.allocated, stats.bytes_allocated / (1024.0 * 1024.0), stats.reused);
+        }
+        image_pool_destroy(pool);
     }
 
     printf("========================================\n");
-    printf("All filters applied successfully\n\n");
+    if (success) {
+        printf("All filters applied successfully\n\n");
+    }
+
+    return success;
+}
+
+// Удаление первого фильтра пайплайна
+static void pipeline_remove_head(FilterPipeline* pipeline) {
+    FilterNode* node = pipeline->head;
+    if (!node) {
+        return;
+    }
+
+    pipeline->head = node->next;
+    if (!pipeline->head) {
+        pipeline->tail = NULL;
+    }
+    pipeline->count--;
+
+    free(node->params);
+    free(node->name);
+    free(node);
+}
+
+bool pipeline_take_input_region(FilterPipeline* pipeline, int width, int height,
+                                CropParams* region) {
+    if (!pipeline || !region) {
+        return false;
+    }
+
+    region->x = 0;
+    region->y = 0;
+    region->width = width;
+    region->height = height;
+
+    bool taken = false;
+
+    // Последовательные обрезки складываются в одну область
+    while (pipeline->head && pipeline->head->function == filter_crop && pipeline->head->params) {
+        CropParams* crop = (CropParams*)pipeline->head->params;
+
+        // Ошибочную обрезку оставляем фильтру, чтобы он сообщил об ошибке
+        if (crop->x < 0 || crop->y < 0 || crop->x >= region->width || crop->y >= region->height ||
+            crop->width <= 0 || crop->height <= 0) {
+            break;
+        }
+
+        region->x += crop->x;
+        region->y += crop->y;
+        region->width = crop->width < region->width - crop->x ? crop->width : region->width - crop->x;
+        region->height = crop->height < region->height - crop->y ? crop->height : region->height - crop->y;
+
+        pipeline_remove_head(pipeline);
+        taken = true;
+    }
+
+    if (taken) {
+        printf("Crop %dx%d at (%d, %d) is pushed down to the image reader\n",
+               region->width, region->height, region->x, region->y);
+    }
+
+    return taken;
 }
 
 void pipeline_clear(FilterPipeline* pipeline) {
@@ -3,13 +3,17 @@
 
 #include "image.h"
 #include "filters.h"
+#include "registry.h"
 
-// Тип функции фильтра
-typedef void (*FilterFunc)(Image*, void*);
+// Сторона плитки при поплиточном выполнении цепочек фильтров. Плитка
+// в формате float (~0.75 МБ) помещается в кэш L2, пока по ней проходит
+// вся цепочка; меньшие плитки тратят больше времени на ореолы.
+#define PIPELINE_TILE_SIZE 256
 
 // Структура для представления фильтра в пайплайне
 typedef struct FilterNode {
     FilterFunc function;
+    const FilterDescriptor* descriptor;   // Свойства фильтра; NULL у незарегистрированных
     void* params;
     char* name;
     struct FilterNode* next;
@@ -26,14 +30,37 @@ typedef struct {
 FilterPipeline* pipeline_create(void);
 void pipeline_destroy(FilterPipeline* pipeline);
 
-// Добавление фильтра в пайплайн
+// Добавление фильтра в пайплайн; описание фильтра ищется в реестре по функции
 void pipeline_add_filter(FilterPipeline* pipeline,
                         FilterFunc function,
                         void* params,
                         const char* name);
 
-// Применение пайплайна к изображению
-void pipeline_apply(FilterPipeline* pipeline, Image* image);
+// Применение пайплайна к изображению. false, если фильтры применены не все
+// (не удалось перевести изображение в формат фильтра); сообщение выводится.
+bool pipeline_apply(FilterPipeline* pipeline, Image* image);
+
+// Перенос начальных фильтров crop в чтение изображения. Если пайплайн
+// начинается с обрезки, эти фильтры удаляются из него, а в region
+// записывается итоговая область изображения width x height, которую
+// достаточно прочитать. Возвращает false, если переносить нечего.
+bool pipeline_take_input_region(FilterPipeline* pipeline, int width, int height,
+                                CropParams* region);
+
+// Ореол фильтра: на сколько пикселей в каждую сторону результат зависит
+// от соседей (у обрезки 0). false, если ореол фильтра неизвестен или
+// результат у краев зависит от противоположного края (BORDER_WRAP).
+// У Canny ореола нет: гистерезис связывает границы по всему изображению.
+bool pipeline_filter_halo(const FilterNode* node, int* halo);
+
+// Примерная стоимость фильтра на пиксель (FilterDescriptor::cost)
+float pipeline_filter_cost(const FilterNode* node);
+
+// Применение фильтра к части image изображения full_width x full_height
+// с левым верхним углом (x, y). Фильтры, зависящие от положения пикселя
+// в изображении (виньетка), учитывают смещение части.
+void pipeline_run_filter_at(const FilterNode* node, Image* image, int x, int y,
+                            int full_width, int full_height);
 
 // Очистка пайплайна
 void pipeline_clear(FilterPipeline* pipeline);
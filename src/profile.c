@@ -0,0 +1,278 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "profile.h"
+#include "image.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+// Длина имени этапа
+#define PROFILE_NAME_SIZE 96
+
+typedef struct {
+    char name[PROFILE_NAME_SIZE];
+    int calls;
+    long long pixels;
+    double wall;
+    double cpu;
+    size_t bytes_allocated;
+    size_t peak_rss;          // Пиковый RSS процесса к концу последнего замера
+} ProfileStage;
+
+static bool enabled = false;
+static ProfileStage* stages = NULL;
+static int stage_count = 0;
+static int stage_capacity = 0;
+
+double profile_time(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+// Процессорное время процесса (все потоки, пользователь и ядро)
+static double profile_cpu_time(void) {
+#ifdef _WIN32
+    FILETIME creation, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exited, &kernel, &user)) {
+        return 0.0;
+    }
+
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (double)(k.QuadPart + u.QuadPart) * 1e-7;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+// Наибольший объем памяти процесса в ОЗУ с начала работы, байт
+static size_t profile_peak_rss(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return (size_t)usage.ru_maxrss * 1024;   // Linux: килобайты
+#endif
+}
+
+void profile_enable(bool enable) {
+    enabled = enable;
+}
+
+bool profile_enabled(void) {
+    return enabled;
+}
+
+int profile_stage(const char* name) {
+    if (!enabled) {
+        return -1;
+    }
+
+    if (stage_count == stage_capacity) {
+        int capacity = stage_capacity ? stage_capacity * 2 : 16;
+        ProfileStage* grown = (ProfileStage*)realloc(stages, sizeof(ProfileStage) * capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for profile stage\n");
+            return -1;
+        }
+        stages = grown;
+        stage_capacity = capacity;
+    }
+
+    ProfileStage* stage = &stages[stage_count];
+    memset(stage, 0, sizeof(ProfileStage));
+    snprintf(stage->name, sizeof(stage->name), "%s", name);
+    return stage_count++;
+}
+
+void profile_begin(ProfileMark* mark) {
+    if (!enabled) {
+        return;
+    }
+
+    mark->bytes_allocated = image_total_bytes_allocated();
+    mark->cpu = profile_cpu_time();
+    mark->wall = profile_time();
+}
+
+// Доля share замера от mark до текущего момента - к этапу index
+static void profile_add(int index, const ProfileMark* mark, const ProfileMark* now,
+                        double share, long long pixels) {
+    if (index < 0 || index >= stage_count) {
+        return;
+    }
+
+    ProfileStage* stage = &stages[index];
+    stage->calls++;
+    stage->pixels += pixels;
+    stage->wall += (now->wall - mark->wall) * share;
+    stage->cpu += (now->cpu - mark->cpu) * share;
+    stage->bytes_allocated += (size_t)((now->bytes_allocated - mark->bytes_allocated) * share + 0.5);
+    stage->peak_rss = profile_peak_rss();
+}
+
+void profile_record(int index, const ProfileMark* mark, long long pixels) {
+    if (!enabled) {
+        return;
+    }
+
+    ProfileMark now;
+    profile_begin(&now);
+    profile_add(index, mark, &now, 1.0, pixels);
+}
+
+void profile_record_split(const ProfileMark* mark, const char* const* names,
+                          const double* weights, int count, long long pixels) {
+    if (!enabled) {
+        return;
+    }
+
+    ProfileMark now;
+    profile_begin(&now);
+
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        sum += weights[i];
+    }
+
+    for (int i = 0; i < count; i++) {
+        double share = sum > 0 ? weights[i] / sum : 1.0 / count;
+        profile_add(profile_stage(names[i]), mark, &now, share, pixels);
+    }
+}
+
+// Мегапикселей в секунду
+static double profile_throughput(const ProfileStage* stage) {
+    return stage->wall > 0 ? stage->pixels / stage->wall * 1e-6 : 0.0;
+}
+
+static void profile_print_row(const ProfileStage* stage) {
+    const double mb = 1024.0 * 1024.0;
+    printf("  %-36.36s %10.2f %10.2f %9.1f %10.1f %10.1f\n", stage->name,
+           stage->wall * 1e3, stage->cpu * 1e3, profile_throughput(stage),
+           stage->bytes_allocated / mb, stage->peak_rss / mb);
+}
+
+// Строка JSON с экранированием кавычек, обратной косой черты и управляющих символов
+static void profile_json_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(file, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(file, "\\u%04x", *p);
+        } else {
+            fputc(*p, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static void profile_json_stage(FILE* file, const ProfileStage* stage) {
+    fprintf(file, "{\"name\": ");
+    profile_json_string(file, stage->name);
+    // Счетчики через double: %zu и %lld не везде поддерживаются msvcrt
+    fprintf(file, ", \"calls\": %d, \"pixels\": %.0f, \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, "
+                  "\"megapixels_per_second\": %.3f, \"bytes_allocated\": %.0f, \"peak_rss_bytes\": %.0f}",
+            stage->calls, (double)stage->pixels, stage->wall, stage->cpu, profile_throughput(stage),
+            (double)stage->bytes_allocated, (double)stage->peak_rss);
+}
+
+bool profile_report(const char* json_file) {
+    if (!enabled) {
+        return true;
+    }
+
+    // Итог: суммы по этапам, пиковый RSS - всего процесса
+    ProfileStage total;
+    memset(&total, 0, sizeof(ProfileStage));
+    snprintf(total.name, sizeof(total.name), "total");
+
+    for (int i = 0; i < stage_count; i++) {
+        total.calls += stages[i].calls;
+        total.wall += stages[i].wall;
+        total.cpu += stages[i].cpu;
+        total.bytes_allocated += stages[i].bytes_allocated;
+    }
+    total.peak_rss = profile_peak_rss();
+
+    printf("\nProfile (%d thread(s)):\n", parallel_get_threads());
+    printf("  %-36s %10s %10s %9s %10s %10s\n", "Stage", "Wall, ms", "CPU, ms", "MP/s",
+           "Alloc, MB", "Peak, MB");
+    for (int i = 0; i < stage_count; i++) {
+        profile_print_row(&stages[i]);
+    }
+    profile_print_row(&total);
+
+    FILE* file = json_file ? fopen(json_file, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open profile file '%s'\n", json_file);
+        return false;
+    }
+
+    if (!json_file) {
+        printf("\n");
+    }
+
+    fprintf(file, "{\"threads\": %d, \"stages\": [", parallel_get_threads());
+    for (int i = 0; i < stage_count; i++) {
+        fprintf(file, "%s\n  ", i > 0 ? "," : "");
+        profile_json_stage(file, &stages[i]);
+    }
+    fprintf(file, "],\n \"total\": ");
+    profile_json_stage(file, &total);
+    fprintf(file, "}\n");
+
+    bool success = !ferror(file);
+    if (json_file) {
+        success = fclose(file) == 0 && success;
+        if (success) {
+            printf("Profile written to %s\n", json_file);
+        }
+    }
+
+    if (!success) {
+        fprintf(stderr, "Error: Cannot write profile file '%s'\n", json_file ? json_file : "stdout");
+    }
+
+    free(stages);
+    stages = NULL;
+    stage_count = stage_capacity = 0;
+    return success;
+}
@@ -0,0 +1,45 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Замеры этапов обработки для -profile: декодирование, шаги пайплайна,
+// кодирование. Этап может замеряться несколько раз (полосы потокового
+// режима), замеры складываются. Замеры выполняются из главного потока;
+// процессорное время - всего процесса, то есть всех потоков пула.
+
+// Начало замера
+typedef struct {
+    double wall;              // Секунды от произвольного начала отсчета
+    double cpu;               // Процессорное время процесса, секунды
+    size_t bytes_allocated;   // image_total_bytes_allocated() в начале
+} ProfileMark;
+
+// Включение замеров (по умолчанию выключены; тогда функции ничего не делают)
+void profile_enable(bool enabled);
+bool profile_enabled(void);
+
+// Новый этап name в конце отчета; возвращает его номер или -1
+int profile_stage(const char* name);
+
+void profile_begin(ProfileMark* mark);
+
+// Монотонное время в секундах (для замеров частей шага)
+double profile_time(void);
+
+// Добавление к этапу stage времени и памяти с начала замера mark;
+// pixels - число обработанных пикселей (для мегапикселей в секунду)
+void profile_record(int stage, const ProfileMark* mark, long long pixels);
+
+// Замер шага, выполнившего сразу несколько фильтров (плитки, слитый проход):
+// время и память с начала mark делятся между новыми этапами names[0, count)
+// пропорционально weights (все веса 0 - поровну)
+void profile_record_split(const ProfileMark* mark, const char* const* names,
+                          const double* weights, int count, long long pixels);
+
+// Таблица этапов в stdout и JSON в файл json_file (NULL - в stdout),
+// после чего этапы удаляются. false, если файл не удалось записать.
+bool profile_report(const char* json_file);
+
+#endif // PROFILE_H
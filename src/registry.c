@@ -0,0 +1,766 @@
+#include "registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Ореол фильтра с окном radius; с BORDER_WRAP пиксели у краев зависят
+// от противоположного края, которого нет в плитке или полосе строк
+static bool stencil_halo(int radius, int* halo) {
+    if (filters_get_border().mode == BORDER_WRAP) {
+        return false;
+    }
+
+    *halo = radius;
+    return true;
+}
+
+// Ореол поточечных фильтров и обрезки
+static bool no_halo(const void* params, int* halo) {
+    (void)params;
+    *halo = 0;
+    return true;
+}
+
+// Стоимость копирования и поточечных фильтров без вычислений
+static float unit_cost(const void* params) {
+    (void)params;
+    return 1.0f;
+}
+
+// Память под параметры size; NULL и сообщение missing, если аргументов меньше needed
+static void* parse_alloc(size_t size, int count, int needed, const char* missing, const char** error) {
+    if (count < needed) {
+        *error = missing;
+        return NULL;
+    }
+
+    void* params = calloc(1, size);
+    if (!params) {
+        *error = "Memory allocation failed";
+    }
+    return params;
+}
+
+// Обрезка
+
+static void* crop_parse(char** args, int count, int* used, const char** error) {
+    CropParams* params = (CropParams*)parse_alloc(sizeof(CropParams), count, 2,
+                                                  "-crop requires width and height", error);
+    if (!params) {
+        return NULL;
+    }
+
+    params->width = atoi(args[0]);
+    params->height = atoi(args[1]);
+
+    if (params->width <= 0 || params->height <= 0) {
+        free(params);
+        *error = "Crop dimensions must be positive";
+        return NULL;
+    }
+
+    *used = 2;
+
+    // Необязательное смещение области: -crop W H X Y
+    if (count >= 4 && args[2][0] != '-' && args[3][0] != '-') {
+        params->x = atoi(args[2]);
+        params->y = atoi(args[3]);
+        *used = 4;
+    }
+
+    return params;
+}
+
+static float crop_cost(const void* params) {
+    (void)params;
+    return 0.0f;
+}
+
+static void crop_describe(const void* params, char* text, size_t size) {
+    const CropParams* crop = (const CropParams*)params;
+    snprintf(text, size, "%dx%d at (%d, %d)", crop->width, crop->height, crop->x, crop->y);
+}
+
+// Поточечные фильтры
+
+static bool grayscale_step(const void* params, PointwiseStep* step) {
+    (void)params;
+    step->op = POINTWISE_GRAYSCALE;
+    step->intensity = 0.0f;
+    return true;
+}
+
+static bool negative_step(const void* params, PointwiseStep* step) {
+    (void)params;
+    step->op = POINTWISE_NEGATIVE;
+    step->intensity = 0.0f;
+    return true;
+}
+
+static bool sepia_step(const void* params, PointwiseStep* step) {
+    (void)params;
+    step->op = POINTWISE_SEPIA;
+    step->intensity = 0.0f;
+    return true;
+}
+
+static float sepia_cost(const void* params) {
+    (void)params;
+    return 3.0f;
+}
+
+static void* vignette_parse(char** args, int count, int* used, const char** error) {
+    VignetteParams* params = (VignetteParams*)parse_alloc(sizeof(VignetteParams), count, 0, NULL, error);
+    if (!params) {
+        return NULL;
+    }
+
+    // Значение по умолчанию
+    params->intensity = 0.8f;
+
+    // Проверяем, есть ли параметр интенсивности
+    if (count >= 1 && args[0][0] != '-') {
+        params->intensity = (float)atof(args[0]);
+        *used = 1;
+    }
+
+    return params;
+}
+
+static float vignette_intensity(const void* params) {
+    return params ? ((const VignetteParams*)params)->intensity : 0.8f;
+}
+
+static bool vignette_check(const void* params) {
+    float intensity = vignette_intensity(params);
+    return intensity >= 0 && intensity <= 1;
+}
+
+static float vignette_cost(const void* params) {
+    (void)params;
+    return 2.0f;
+}
+
+// Виньетка с ошибочной интенсивностью выполняется отдельно, чтобы предупредить о ней
+static bool vignette_step(const void* params, PointwiseStep* step) {
+    step->op = POINTWISE_VIGNETTE;
+    step->intensity = vignette_intensity(params);
+    return vignette_check(params);
+}
+
+static void vignette_describe(const void* params, char* text, size_t size) {
+    snprintf(text, size, "%.2f", vignette_intensity(params));
+}
+
+// Центр виньетки считается по всему изображению, а не по его части
+static void vignette_apply_at(Image* image, const void* params, int x, int y,
+                              int full_width, int full_height) {
+    float intensity = vignette_intensity(params);
+    intensity = intensity < 0 ? 0 : (intensity > 1 ? 1 : intensity);
+    apply_vignette(image, intensity, x, y, full_width, full_height);
+}
+
+// Резкость, тиснение и поиск границ
+
+// Ореол фильтров с окном 3x3
+static bool neighbor_halo(const void* params, int* halo) {
+    (void)params;
+    return stencil_halo(1, halo);
+}
+
+static float sharpening_cost(const void* params) {
+    (void)params;
+    return 5.0f;
+}
+
+// Ненулевых весов ядра тиснения
+static float emboss_cost(const void* params) {
+    (void)params;
+    return 7.0f;
+}
+
+static void* edge_parse(char** args, int count, int* used, const char** error) {
+    EdgeParams* params = (EdgeParams*)parse_alloc(sizeof(EdgeParams), count, 1,
+                                                  "-edge requires threshold", error);
+    if (!params) {
+        return NULL;
+    }
+
+    params->threshold = (float)atof(args[0]);
+
+    if (params->threshold < 0 || params->threshold > 1) {
+        free(params);
+        *error = "Edge threshold must be between 0 and 1";
+        return NULL;
+    }
+
+    *used = 1;
+    return params;
+}
+
+static bool edge_check(const void* params) {
+    return params != NULL;
+}
+
+static void edge_describe(const void* params, char* text, size_t size) {
+    snprintf(text, size, "%.3g", ((const EdgeParams*)params)->threshold);
+}
+
+// Лапласиан считается по одному каналу яркости
+static float edge_cost(const void* params) {
+    (void)params;
+    return 3.0f;
+}
+
+static void* canny_parse(char** args, int count, int* used, const char** error) {
+    CannyParams* params = (CannyParams*)parse_alloc(sizeof(CannyParams), count, 2,
+                                                    "-canny requires low and high thresholds", error);
+    if (!params) {
+        return NULL;
+    }
+
+    params->low = (float)atof(args[0]);
+    params->high = (float)atof(args[1]);
+    params->sigma = 1.4f;
+    *used = 2;
+
+    // Необязательная sigma размытия
+    if (count >= 3 && args[2][0] != '-') {
+        params->sigma = (float)atof(args[2]);
+        *used = 3;
+    }
+
+    if (params->low < 0 || params->high > 1 || params->low > params->high) {
+        free(params);
+        *error = "Canny thresholds must satisfy 0 <= low <= high <= 1";
+        return NULL;
+    }
+
+    if (params->sigma < 0) {
+        free(params);
+        *error = "Canny sigma must not be negative";
+        return NULL;
+    }
+
+    return params;
+}
+
+// Размытие одного канала яркости, градиент, подавление и связывание
+static float canny_cost(const void* params) {
+    float sigma = params ? ((const CannyParams*)params)->sigma : 0.0f;
+    float blur = sigma > 0 ? 2.0f * (2 * ceilf(3 * sigma) + 1) : 0.0f;
+    return (blur + 24.0f) / 3.0f;
+}
+
+static void canny_describe(const void* params, char* text, size_t size) {
+    const CannyParams* canny = (const CannyParams*)params;
+    snprintf(text, size, "%.3g %.3g, sigma %.3g", canny->low, canny->high, canny->sigma);
+}
+
+// Адаптивный порог
+
+static void* threshold_parse(char** args, int count, int* used, const char** error) {
+    ThresholdParams* params = (ThresholdParams*)parse_alloc(sizeof(ThresholdParams), count, 1,
+                                                            "-threshold requires radius", error);
+    if (!params) {
+        return NULL;
+    }
+
+    params->radius = atoi(args[0]);
+    *used = 1;
+
+    // Необязательное смещение порога
+    if (count >= 2 && (args[1][0] != '-' || (args[1][1] >= '0' && args[1][1] <= '9'))) {
+        params->offset = (float)atof(args[1]);
+        *used = 2;
+    }
+
+    if (params->radius <= 0) {
+        free(params);
+        *error = "Threshold radius must be positive";
+        return NULL;
+    }
+
+    if (params->offset < -1 || params->offset > 1) {
+        free(params);
+        *error = "Threshold offset must be between -1 and 1";
+        return NULL;
+    }
+
+    return params;
+}
+
+// Окно обрезается краями изображения, а не продолжается за них
+static bool threshold_halo(const void* params, int* halo) {
+    if (!params) {
+        return false;
+    }
+
+    *halo = ((const ThresholdParams*)params)->radius;
+    return true;
+}
+
+// Таблица сумм трех каналов и по четыре обращения к ней для окна и пикселя
+static float threshold_cost(const void* params) {
+    (void)params;
+    return 10.0f;
+}
+
+static void threshold_describe(const void* params, char* text, size_t size) {
+    const ThresholdParams* threshold = (const ThresholdParams*)params;
+    snprintf(text, size, "radius %d, offset %.3g", threshold->radius, threshold->offset);
+}
+
+// Медиана
+
+static void* median_parse(char** args, int count, int* used, const char** error) {
+    MedianParams* params = (MedianParams*)parse_alloc(sizeof(MedianParams), count, 1,
+                                                      "-med requires window size", error);
+    if (!params) {
+        return NULL;
+    }
+
+    params->window_size = atoi(args[0]);
+
+    if (params->window_size <= 0 || params->window_size % 2 == 0) {
+        free(params);
+        *error = "Median window size must be odd and positive";
+        return NULL;
+    }
+
+    *used = 1;
+    return params;
+}
+
+static bool median_halo(const void* params, int* halo) {
+    if (!params) {
+        return false;
+    }
+
+    *halo = ((const MedianParams*)params)->window_size / 2;
+    return true;
+}
+
+static bool median_check(const void* params) {
+    int window = ((const MedianParams*)params)->window_size;
+    return window > 0 && window % 2 == 1;
+}
+
+// Окна 3 и 5 - сети сравнений, большие окна - гистограммы со скользящим обновлением
+static float median_cost(const void* params) {
+    int window = params ? ((const MedianParams*)params)->window_size : 3;
+    return window <= 5 ? (float)(window * window) : 2.0f * window + 32.0f;
+}
+
+static void median_describe(const void* params, char* text, size_t size) {
+    snprintf(text, size, "%d", ((const MedianParams*)params)->window_size);
+}
+
+// Гауссово размытие
+
+static void* blur_parse(char** args, int count, int* used, const char** error) {
+    BlurParams* params = (BlurParams*)parse_alloc(sizeof(BlurParams), count, 1,
+                                                  "-blur requires sigma", error);
+    if (!params) {
+        return NULL;
+    }
+
+    params->sigma = (float)atof(args[0]);
+    params->mode = BLUR_GAUSSIAN;
+
+    if (params->sigma <= 0) {
+        free(params);
+        *error = "Blur sigma must be positive";
+        return NULL;
+    }
+
+    *used = 1;
+
+    // Необязательный способ размытия
+    if (count >= 2 && strcmp(args[1], "box") == 0) {
+        params->mode = BLUR_BOX;
+        *used = 2;
+    }
+
+    return params;
+}
+
+static bool blur_halo(const void* params, int* halo) {
+    if (!params) {
+        return false;
+    }
+
+    // Box-проходы всегда продолжают изображение крайним пикселем
+    const BlurParams* blur = (const BlurParams*)params;
+    if (blur->mode == BLUR_BOX) {
+        *halo = box_gaussian_radius(blur->sigma);
+        return true;
+    }
+
+    return stencil_halo(gaussian_blur_radius(blur->sigma), halo);
+}
+
+// Рекурсивный фильтр (радиус больше 3 sigma) бесконечен
+static bool blur_finite(const void* params) {
+    const BlurParams* blur = (const BlurParams*)params;
+    return blur->mode == BLUR_BOX || gaussian_blur_radius(blur->sigma) <= (int)ceil(3 * blur->sigma);
+}
+
+static bool blur_check(const void* params) {
+    return ((const BlurParams*)params)->sigma > 0;
+}
+
+// Ядро по строкам и столбцам; рекурсивный фильтр и box-проходы не зависят от sigma
+static float blur_cost(const void* params) {
+    const BlurParams* blur = (const BlurParams*)params;
+    if (!blur || blur->sigma <= 0) {
+        return 0.0f;
+    }
+
+    if (blur->mode == BLUR_BOX) {
+        return 12.0f;
+    }
+
+    // Радиус больше 3 sigma только у рекурсивного фильтра
+    int radius = gaussian_blur_radius(blur->sigma);
+    if (radius > (int)ceil(3 * blur->sigma)) {
+        return 16.0f;
+    }
+
+    return 2.0f * (2 * radius + 1);
+}
+
+// Гауссовы размытия подряд складываются по дисперсии: sigma^2 = sigma1^2 + sigma2^2.
+// Точно только для бесконечного ядра без краев, поэтому объединение приближенное.
+static void* blur_merge(const void* first, const void* second) {
+    const BlurParams* a = (const BlurParams*)first;
+    const BlurParams* b = (const BlurParams*)second;
+
+    if (!a || !b || a->sigma <= 0 || b->sigma <= 0 || a->mode != b->mode) {
+        return NULL;
+    }
+
+    BlurParams* params = (BlurParams*)malloc(sizeof(BlurParams));
+    if (params) {
+        params->sigma = sqrtf(a->sigma * a->sigma + b->sigma * b->sigma);
+        params->mode = a->mode;
+    }
+    return params;
+}
+
+static void blur_describe(const void* params, char* text, size_t size) {
+    const BlurParams* blur = (const BlurParams*)params;
+    snprintf(text, size, "sigma %.3g%s", blur->sigma, blur->mode == BLUR_BOX ? " box" : "");
+}
+
+static void* box_parse(char** args, int count, int* used, const char** error) {
+    BoxBlurParams* params = (BoxBlurParams*)parse_alloc(sizeof(BoxBlurParams), count, 1,
+                                                        "-boxblur requires radius", error);
+    if (!params) {
+        return NULL;
+    }
+
+    params->radius = atoi(args[0]);
+
+    if (params->radius <= 0) {
+        free(params);
+        *error = "Box blur radius must be positive";
+        return NULL;
+    }
+
+    *used = 1;
+    return params;
+}
+
+static bool box_halo(const void* params, int* halo) {
+    if (!params) {
+        return false;
+    }
+
+    *halo = ((const BoxBlurParams*)params)->radius;
+    return true;
+}
+
+static bool box_check(const void* params) {
+    return ((const BoxBlurParams*)params)->radius > 0;
+}
+
+// Скользящая сумма: сложение и вычитание по строкам и по столбцам
+static float box_cost(const void* params) {
+    (void)params;
+    return 4.0f;
+}
+
+static void box_describe(const void* params, char* text, size_t size) {
+    snprintf(text, size, "radius %d", ((const BoxBlurParams*)params)->radius);
+}
+
+// Свертка
+
+// Пустое ядро свертки width x height; NULL и сообщение в error при ошибке
+static ConvParams* kernel_create(int width, int height, const char** error) {
+    if (width < 1 || height < 1 || width % 2 == 0 || height % 2 == 0 ||
+        width > CONV_MAX_SIZE || height > CONV_MAX_SIZE) {
+        *error = "Kernel sides must be odd and at most 63";
+        return NULL;
+    }
+
+    ConvParams* params = (ConvParams*)calloc(1, sizeof(ConvParams) + sizeof(float) * width * height);
+    if (!params) {
+        *error = "Memory allocation failed";
+        return NULL;
+    }
+
+    params->width = width;
+    params->height = height;
+    return params;
+}
+
+// Ядро свертки из строки "ШxВ:w1,w2,...[/делитель]" или из файла, в котором
+// через пробелы записаны ширина, высота, веса по строкам и необязательный делитель
+static ConvParams* kernel_parse(const char* spec, const char** error) {
+    int width = 0, height = 0, consumed = 0;
+
+    if (sscanf(spec, "%dx%d:%n", &width, &height, &consumed) == 2 && consumed > 0) {
+        ConvParams* params = kernel_create(width, height, error);
+        if (!params) {
+            return NULL;
+        }
+
+        const char* p = spec + consumed;
+        for (int i = 0; i < width * height; i++) {
+            char* end;
+            params->weights[i] = strtof(p, &end);
+
+            bool separated = i == width * height - 1 || *end == ',';
+            if (end == p || !separated) {
+                free(params);
+                *error = "Kernel needs width * height comma-separated weights";
+                return NULL;
+            }
+            p = *end == ',' ? end + 1 : end;
+        }
+
+        if (*p == '/') {
+            char* end;
+            params->divisor = strtof(p + 1, &end);
+            p = end;
+        }
+
+        if (*p != '\0') {
+            free(params);
+            *error = "Unexpected characters after kernel weights";
+            return NULL;
+        }
+
+        return params;
+    }
+
+    FILE* file = fopen(spec, "r");
+    if (!file) {
+        *error = "Cannot open kernel file";
+        return NULL;
+    }
+
+    ConvParams* params = NULL;
+    if (fscanf(file, "%d %d", &width, &height) != 2) {
+        *error = "Kernel file must start with width and height";
+    } else if ((params = kernel_create(width, height, error)) != NULL) {
+        for (int i = 0; i < width * height; i++) {
+            if (fscanf(file, "%f", &params->weights[i]) != 1) {
+                free(params);
+                params = NULL;
+                *error = "Kernel file has fewer weights than width * height";
+                break;
+            }
+        }
+
+        if (params && fscanf(file, "%f", &params->divisor) != 1) {
+            params->divisor = 0.0f;
+        }
+    }
+
+    fclose(file);
+    return params;
+}
+
+static void* conv_parse(char** args, int count, int* used, const char** error) {
+    if (count < 1) {
+        *error = "-conv requires kernel";
+        return NULL;
+    }
+
+    ConvParams* params = kernel_parse(args[0], error);
+    *used = 1;
+    return params;
+}
+
+static bool conv_halo(const void* params, int* halo) {
+    if (!params) {
+        return false;
+    }
+
+    const ConvParams* conv = (const ConvParams*)params;
+    return stencil_halo((conv->width > conv->height ? conv->width : conv->height) / 2, halo);
+}
+
+static bool conv_check(const void* params) {
+    const ConvParams* conv = (const ConvParams*)params;
+    return conv->width % 2 == 1 && conv->height % 2 == 1 &&
+           conv->width <= CONV_MAX_SIZE && conv->height <= CONV_MAX_SIZE;
+}
+
+// Без учета разделения ядра ранга 1 на два прохода - оценка сверху
+static float conv_cost(const void* params) {
+    const ConvParams* conv = (const ConvParams*)params;
+    return conv ? (float)(conv->width * conv->height) : 0.0f;
+}
+
+static void conv_describe(const void* params, char* text, size_t size) {
+    const ConvParams* conv = (const ConvParams*)params;
+    snprintf(text, size, "%dx%d kernel", conv->width, conv->height);
+}
+
+// Фильтры в порядке справки
+static const FilterDescriptor filter_registry[] = {
+    {
+        .option = "-crop", .name = "crop", .function = filter_crop,
+        .flags = FILTER_RESIZES, .formats = FILTER_FORMATS_COLOR,
+        .usage = "<ширина> <высота> [x y]",
+        .help = "Обрезать изображение (смещение по умолчанию 0 0)",
+        .parse = crop_parse, .halo = no_halo, .cost = crop_cost, .describe = crop_describe
+    },
+    {
+        .option = "-gs", .name = "grayscale", .function = filter_grayscale,
+        .flags = FILTER_POINTWISE | FILTER_IDEMPOTENT, .formats = FILTER_FORMATS_COLOR,
+        .help = "Градации серого",
+        .halo = no_halo, .cost = unit_cost, .pointwise = grayscale_step
+    },
+    {
+        .option = "-neg", .name = "negative", .function = filter_negative,
+        .flags = FILTER_POINTWISE | FILTER_INVOLUTION, .formats = FILTER_FORMATS_COLOR,
+        .help = "Негатив",
+        .halo = no_halo, .cost = unit_cost, .pointwise = negative_step
+    },
+    {
+        .option = "-sharp", .name = "sharpening", .function = filter_sharpening,
+        .flags = FILTER_BORDER | FILTER_FLOAT, .formats = FILTER_FORMATS_COLOR,
+        .help = "Повышение резкости",
+        .halo = neighbor_halo, .cost = sharpening_cost
+    },
+    {
+        .option = "-emboss", .name = "emboss", .function = filter_emboss,
+        .flags = FILTER_BORDER | FILTER_FLOAT, .formats = FILTER_FORMATS_COLOR,
+        .help = "Тиснение",
+        .halo = neighbor_halo, .cost = emboss_cost
+    },
+    {
+        .option = "-edge", .name = "edge_detection", .function = filter_edge_detection,
+        .flags = FILTER_BORDER | FILTER_MASK,
+        .formats = FILTER_FORMATS_COLOR | FILTER_FORMAT(PIXEL_FORMAT_MASK),
+        .usage = "<порог>",
+        .help = "Обнаружение границ (0-1); если фильтр последний,\n"
+                "результат записывается 1-битным BMP",
+        .parse = edge_parse, .halo = neighbor_halo, .check = edge_check, .cost = edge_cost,
+        .describe = edge_describe
+    },
+    {
+        .option = "-canny", .name = "canny", .function = filter_canny,
+        .flags = FILTER_BORDER | FILTER_MASK | FILTER_GLOBAL,
+        .formats = FILTER_FORMATS_COLOR | FILTER_FORMAT(PIXEL_FORMAT_MASK),
+        .usage = "<нижний> <верхний> [сигма]",
+        .help = "Границы Canny: пороги гистерезиса (0-1) и\n"
+                "размытие (по умолчанию 1.4); 1-битный BMP",
+        .parse = canny_parse, .cost = canny_cost, .describe = canny_describe
+    },
+    {
+        .option = "-threshold", .name = "adaptive_threshold", .function = filter_adaptive_threshold,
+        .flags = FILTER_MASK,
+        .formats = FILTER_FORMATS_COLOR | FILTER_FORMAT(PIXEL_FORMAT_MASK),
+        .usage = "<радиус> [смещение]",
+        .help = "Адаптивный порог по среднему окна (2 * радиус + 1)\n"
+                "минус смещение; если фильтр последний,\n"
+                "результат записывается 1-битным BMP",
+        .parse = threshold_parse, .halo = threshold_halo, .cost = threshold_cost,
+        .describe = threshold_describe
+    },
+    {
+        .option = "-med", .name = "median", .function = filter_median,
+        .formats = FILTER_FORMATS_COLOR,
+        .usage = "<размер_окна>",
+        .help = "Медианный фильтр (нечетный)",
+        .parse = median_parse, .halo = median_halo, .check = median_check, .cost = median_cost,
+        .describe = median_describe
+    },
+    {
+        .option = "-blur", .name = "gaussian_blur", .function = filter_gaussian_blur,
+        .flags = FILTER_BORDER | FILTER_FLOAT, .formats = FILTER_FORMATS_COLOR,
+        .usage = "<сигма> [box]",
+        .help = "Гауссово размытие (box - быстрое приближение\n"
+                "тремя проходами box-фильтра)",
+        .parse = blur_parse, .halo = blur_halo, .finite = blur_finite, .check = blur_check, .cost = blur_cost,
+        .merge = blur_merge, .describe = blur_describe
+    },
+    {
+        .option = "-boxblur", .name = "box_blur", .function = filter_box,
+        .flags = FILTER_FLOAT, .formats = FILTER_FORMATS_COLOR,
+        .usage = "<радиус>",
+        .help = "Усреднение по квадрату (2 * радиус + 1)",
+        .parse = box_parse, .halo = box_halo, .check = box_check, .cost = box_cost,
+        .describe = box_describe
+    },
+    {
+        .option = "-conv", .name = "convolution", .function = filter_convolution,
+        .flags = FILTER_BORDER | FILTER_FLOAT, .formats = FILTER_FORMATS_COLOR,
+        .usage = "<ядро>",
+        .help = "Свертка с ядром \"ШxВ:w1,w2,...[/делитель]\" или из\n"
+                "файла: ширина, высота, веса, [делитель]",
+        .parse = conv_parse, .halo = conv_halo, .check = conv_check, .cost = conv_cost,
+        .describe = conv_describe
+    },
+    {
+        .option = "-sepia", .name = "sepia", .function = filter_sepia,
+        .flags = FILTER_POINTWISE | FILTER_FLOAT, .formats = FILTER_FORMATS_COLOR,
+        .help = "Эффект сепии",
+        .halo = no_halo, .cost = sepia_cost, .pointwise = sepia_step
+    },
+    {
+        .option = "-vignette", .name = "vignette", .function = filter_vignette,
+        .flags = FILTER_POINTWISE | FILTER_POSITIONAL | FILTER_FLOAT, .formats = FILTER_FORMATS_COLOR,
+        .usage = "[интенсивность]",
+        .help = "Виньетирование (0-1, по умолчанию 0.8)",
+        .parse = vignette_parse, .halo = no_halo, .check = vignette_check, .cost = vignette_cost,
+        .pointwise = vignette_step, .apply_at = vignette_apply_at, .describe = vignette_describe
+    }
+};
+
+#define FILTER_REGISTRY_COUNT ((int)(sizeof(filter_registry) / sizeof(filter_registry[0])))
+
+int filter_registry_count(void) {
+    return FILTER_REGISTRY_COUNT;
+}
+
+const FilterDescriptor* filter_registry_get(int index) {
+    return index >= 0 && index < FILTER_REGISTRY_COUNT ? &filter_registry[index] : NULL;
+}
+
+const FilterDescriptor* filter_registry_find(const char* option) {
+    for (int i = 0; option && i < FILTER_REGISTRY_COUNT; i++) {
+        if (strcmp(filter_registry[i].option, option) == 0) {
+            return &filter_registry[i];
+        }
+    }
+
+    return NULL;
+}
+
+const FilterDescriptor* filter_registry_find_function(FilterFunc function) {
+    for (int i = 0; function && i < FILTER_REGISTRY_COUNT; i++) {
+        if (filter_registry[i].function == function) {
+            return &filter_registry[i];
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,87 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "filters.h"
+
+// Тип функции фильтра
+typedef void (*FilterFunc)(Image*, void*);
+
+// Свойства фильтра
+typedef enum {
+    FILTER_POINTWISE  = 1 << 0,   // Пиксель результата зависит только от того же пикселя
+    FILTER_RESIZES    = 1 << 1,   // Меняет размеры изображения
+    FILTER_BORDER     = 1 << 2,   // Продолжает изображение за краями (filters_get_border)
+    FILTER_POSITIONAL = 1 << 3,   // Результат зависит от положения пикселя в изображении
+    FILTER_GLOBAL     = 1 << 4,   // Результат зависит от всего изображения, ореола нет
+    FILTER_MASK       = 1 << 5,   // Результат - битовая маска PIXEL_FORMAT_MASK
+    FILTER_FLOAT      = 1 << 6,   // Результат в формате float (целочисленные переводятся в PLANAR)
+    FILTER_INVOLUTION = 1 << 7,   // Два применения подряд к целочисленному формату ничего не меняют
+    FILTER_IDEMPOTENT = 1 << 8    // Повторное применение к целочисленному формату ничего не меняет
+} FilterFlags;
+
+// Множества форматов пикселей, принимаемых фильтром
+#define FILTER_FORMAT(format) (1u << (format))
+#define FILTER_FORMATS_COLOR (FILTER_FORMAT(PIXEL_FORMAT_U8) | FILTER_FORMAT(PIXEL_FORMAT_U16) | \
+                              FILTER_FORMAT(PIXEL_FORMAT_FLOAT) | FILTER_FORMAT(PIXEL_FORMAT_PLANAR))
+
+// Описание фильтра: ключ командной строки, свойства, нужные пайплайну для
+// планирования (ореол, стоимость, поточечность, форматы), и разбор параметров.
+// Необязательные функции могут быть NULL.
+typedef struct {
+    const char* option;          // Ключ командной строки, например "-blur"
+    const char* name;            // Имя узла пайплайна
+    FilterFunc function;
+    unsigned flags;              // FilterFlags
+    unsigned formats;            // Принимаемые форматы, FILTER_FORMAT(...)
+    const char* usage;           // Параметры для справки (или NULL)
+    const char* help;            // Описание для справки, строки через '\n'
+
+    // Разбор параметров из args[0, count) после ключа, в *used - число
+    // взятых аргументов. При ошибке возвращает NULL и сообщение в *error.
+    // NULL вместо функции - у фильтра нет параметров.
+    void* (*parse)(char** args, int count, int* used, const char** error);
+
+    // Ореол при данных параметрах; false, если результат у краев части
+    // изображения зависит от пикселей вне ее ореола. NULL - ореол неизвестен.
+    bool (*halo)(const void* params, int* halo);
+
+    // Ореол точен: за ним соседи не влияют на результат. У бесконечных
+    // (рекурсивных) фильтров ореол отсекает малые вклады, и результат на
+    // части изображения может отличаться в младшем разряде, поэтому по
+    // плиткам они не выполняются (полосы -stream - приближение). NULL - точен.
+    bool (*finite)(const void* params);
+
+    // Параметры допустимы (вызывается, если известен ореол). Фильтры с
+    // ошибочными параметрами выполняются целиком, чтобы сообщить об ошибке
+    // один раз. NULL - всегда допустимы.
+    bool (*check)(const void* params);
+
+    // Примерная стоимость на пиксель: умножений-сложений на канал (NULL - 1)
+    float (*cost)(const void* params);
+
+    // Шаг слитого поточечного прохода; NULL или false - фильтр выполняется отдельно
+    bool (*pointwise)(const void* params, PointwiseStep* step);
+
+    // Применение к части изображения full_width x full_height с левым верхним
+    // углом (x, y), для фильтров FILTER_POSITIONAL
+    void (*apply_at)(Image* image, const void* params, int x, int y,
+                     int full_width, int full_height);
+
+    // Параметры одного фильтра, приближенно заменяющего два подряд с
+    // параметрами first и second (-optimize fast). NULL вместо функции
+    // или результата - фильтры не объединяются.
+    void* (*merge)(const void* first, const void* second);
+
+    // Параметры для вывода плана (-explain); NULL - без параметров
+    void (*describe)(const void* params, char* text, size_t size);
+} FilterDescriptor;
+
+// Число фильтров и фильтр index в порядке справки
+int filter_registry_count(void);
+const FilterDescriptor* filter_registry_get(int index);
+
+// Поиск по ключу командной строки или по функции; NULL, если фильтра нет
+const FilterDescriptor* filter_registry_find(const char* option);
+const FilterDescriptor* filter_registry_find_function(FilterFunc function);
+
+#endif // REGISTRY_H
@@ -0,0 +1,31 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdbool.h>
+
+// Число элементов, обрабатываемых за одну итерацию векторизуемых циклов.
+// Внутренние циклы фиксированной длины SIMD_LANES компилятор переводит
+// в векторные инструкции: SSE2 по умолчанию, AVX2 при сборке с -march=native.
+#define SIMD_LANES 8
+
+// Ядра на встроенных функциях x86 для операций, которые компилятор сам не
+// векторизует (перестановки байтов). Они компилируются для своего набора
+// инструкций атрибутом SIMD_TARGET и выбираются во время выполнения, поэтому
+// работают и без -march=native; на других процессорах - обычные циклы.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+
+static inline bool simd_has_ssse3(void) {
+    return __builtin_cpu_supports("ssse3");
+}
+#endif
+
+// Ограничение значения диапазоном [0, 1] без ветвлений (как color_clamp)
+static inline float clamp01(float value) {
+    value = value < 0.0f ? 0.0f : value;
+    return value > 1.0f ? 1.0f : value;
+}
+
+#endif // SIMD_H
@@ -0,0 +1,375 @@
+#include "stream.h"
+#include "bmp.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Стадия потокового пайплайна (один фильтр)
+typedef struct {
+    const FilterNode* node;
+    int halo;            // Строк соседства сверху и снизу, нужных фильтру
+    int width;           // Размеры входа стадии
+    int height;
+    int out_width;       // Размеры выхода стадии
+    int out_height;
+    bool is_crop;
+    bool passthrough;    // Фильтр не меняет изображение (например, ошибка параметров)
+    int crop_x;
+    int crop_y;
+    Image* window;       // Входные строки [window_first, received)
+    int window_first;
+    int received;        // Получено входных строк
+    int emitted;         // Отдано готовых строк
+    int profile;         // Этап отчета -profile
+} StreamStage;
+
+typedef struct {
+    StreamStage* stages;
+    int count;
+    int window_rows;     // Вместимость окна строк каждой стадии
+    BMPWriter writer;
+    int written;
+    int profile_decode;  // Этапы отчета -profile: чтение и запись полос
+    int profile_encode;
+} Stream;
+
+// Расчет размеров стадий; total_halo - сумма ореолов цепочки
+static bool stream_plan(Stream* stream, const FilterPipeline* pipeline,
+                        int width, int height, int* total_halo) {
+    *total_halo = 0;
+
+    int index = 0;
+    for (const FilterNode* node = pipeline->head; node; node = node->next, index++) {
+        StreamStage* stage = &stream->stages[index];
+        stage->node = node;
+        stage->width = stage->out_width = width;
+        stage->height = stage->out_height = height;
+
+        if (!pipeline_filter_halo(node, &stage->halo)) {
+            fprintf(stderr, "Error: Filter '%s' does not support streaming%s\n", node->name,
+                    filters_get_border().mode == BORDER_WRAP ? " with wrapped borders" : "");
+            return false;
+        }
+
+        if (node->descriptor->finite && !node->descriptor->finite(node->params)) {
+            fprintf(stderr, "Error: Filter '%s' has no exact halo and cannot be streamed\n", node->name);
+            return false;
+        }
+
+        if (node->function == filter_crop) {
+            CropParams* crop = (CropParams*)node->params;
+            ImageView view = {0};
+
+            if (crop && crop->x >= 0 && crop->y >= 0 && crop->x < width && crop->y < height) {
+                // Только размеры: ImageView ограничивает область так же, как filter_crop
+                Image shape = {0};
+                shape.width = width;
+                shape.height = height;
+                shape.stride = width;
+                view = image_view(&shape, crop->x, crop->y, crop->width, crop->height);
+            }
+
+            if (view.width <= 0 || view.height <= 0) {
+                fprintf(stderr, "Error: Invalid crop for %dx%d image, filter skipped\n", width, height);
+                stage->passthrough = true;
+            } else {
+                stage->is_crop = true;
+                stage->crop_x = crop->x;
+                stage->crop_y = crop->y;
+                stage->out_width = view.width;
+                stage->out_height = view.height;
+            }
+        }
+
+        *total_halo += stage->halo;
+        width = stage->out_width;
+        height = stage->out_height;
+    }
+
+    return true;
+}
+
+static bool stream_push(Stream* stream, int index, Image* rows, int first, int count);
+
+bool pipeline_can_stream(const FilterPipeline* pipeline) {
+    int halo;
+    for (const FilterNode* node = pipeline ? pipeline->head : NULL; node; node = node->next) {
+        // Ореол бесконечного фильтра приближенный: полосы изменили бы результат
+        if (!pipeline_filter_halo(node, &halo) ||
+            (node->descriptor->finite && !node->descriptor->finite(node->params))) {
+            return false;
+        }
+    }
+
+    return pipeline != NULL;
+}
+
+// Обрезка: строки вне области отбрасываются, столбцы выбираются областью без копирования
+static bool stream_push_crop(Stream* stream, int index, Image* rows, int first, int count) {
+    StreamStage* stage = &stream->stages[index];
+    ProfileMark mark;
+    profile_begin(&mark);
+
+    int start = stage->received;
+    stage->received += count;
+
+    int a = start > stage->crop_y ? start : stage->crop_y;
+    int b = stage->received < stage->crop_y + stage->out_height ?
+            stage->received : stage->crop_y + stage->out_height;
+
+    if (a >= b) {
+        return true;
+    }
+
+    Image view = *rows;
+    image_apply_view(&view, image_view(rows, stage->crop_x, first + a - start,
+                                       stage->out_width, b - a));
+    profile_record(stage->profile, &mark, (long long)stage->width * count);
+    return stream_push(stream, index + 1, &view, 0, b - a);
+}
+
+// Поточечный фильтр: строки обрабатываются сразу, окно не нужно
+static bool stream_push_pointwise(Stream* stream, int index, Image* rows, int first, int count) {
+    StreamStage* stage = &stream->stages[index];
+    ProfileMark mark;
+    profile_begin(&mark);
+
+    Image* band = image_create_format(stage->width, count, rows->format);
+    if (!band) {
+        return false;
+    }
+
+    image_copy_region(band, 0, 0, rows, 0, first, stage->width, count);
+    pipeline_run_filter_at(stage->node, band, 0, stage->received, stage->width, stage->height);
+
+    stage->received += count;
+    stage->emitted = stage->received;
+    profile_record(stage->profile, &mark, (long long)stage->width * count);
+
+    bool success = stream_push(stream, index + 1, band, 0, count);
+    image_destroy(band);
+    return success;
+}
+
+// Фильтр с ореолом: строки копятся в окне, пока для них не будет полного соседства
+static bool stream_push_stencil(Stream* stream, int index, Image* rows, int first, int count) {
+    StreamStage* stage = &stream->stages[index];
+    int halo = stage->halo;
+    ProfileMark mark;
+    profile_begin(&mark);
+
+    if (!stage->window) {
+        stage->window = image_create_format(stage->width, stream->window_rows, rows->format);
+        if (!stage->window) {
+            return false;
+        }
+    }
+
+    int window_count = stage->received - stage->window_first;
+    if (stage->window->format != rows->format || window_count + count > stream->window_rows) {
+        fprintf(stderr, "Error: Streaming window overflow in filter '%s'\n", stage->node->name);
+        return false;
+    }
+
+    image_copy_region(stage->window, 0, window_count, rows, 0, first, stage->width, count);
+    stage->received += count;
+
+    // Строка готова, когда получены все строки ее соседства
+    int ready = stage->received == stage->height ? stage->height : stage->received - halo;
+    if (ready <= stage->emitted) {
+        profile_record(stage->profile, &mark, 0);
+        return true;
+    }
+
+    // Полоса с ореолом; строки у ее краев, кроме краев изображения, неточны и отбрасываются
+    int lo = stage->emitted - halo > 0 ? stage->emitted - halo : 0;
+    int hi = ready + halo < stage->height ? ready + halo : stage->height;
+
+    Image* band = image_create_format(stage->width, hi - lo, stage->window->format);
+    if (!band) {
+        return false;
+    }
+
+    image_copy_region(band, 0, 0, stage->window, 0, lo - stage->window_first, stage->width, hi - lo);
+    pipeline_run_filter_at(stage->node, band, 0, lo, stage->width, stage->height);
+
+    // Маска последнего фильтра записывается 1-битной, как в bmp_write;
+    // следующим фильтрам она передается в формате U8
+    if (band->format == PIXEL_FORMAT_MASK && !(index + 1 == stream->count && stream->writer.mask) &&
+        !image_convert(band, PIXEL_FORMAT_U8)) {
+        image_destroy(band);
+        return false;
+    }
+
+    profile_record(stage->profile, &mark, (long long)stage->width * (ready - stage->emitted));
+
+    bool success = stream_push(stream, index + 1, band, stage->emitted - lo, ready - stage->emitted);
+    image_destroy(band);
+    stage->emitted = ready;
+
+    // Сдвиг окна: оставляем только ореол над следующей готовой строкой
+    int keep = stage->emitted - halo;
+    if (keep > stage->window_first) {
+        int shift = keep - stage->window_first;
+        int rest = stage->received - keep;
+
+        for (int y = 0; y < rest; y++) {
+            image_copy_region(stage->window, 0, y, stage->window, 0, y + shift, stage->width, 1);
+        }
+        stage->window_first = keep;
+    }
+
+    return success;
+}
+
+// Передача строк [first, first + count) изображения rows на вход стадии index
+static bool stream_push(Stream* stream, int index, Image* rows, int first, int count) {
+    if (count <= 0) {
+        return true;
+    }
+
+    if (index == stream->count) {
+        ProfileMark mark;
+        profile_begin(&mark);
+
+        if (!bmp_writer_write_rows(&stream->writer, stream->written, rows, first, count)) {
+            return false;
+        }
+        stream->written += count;
+        profile_record(stream->profile_encode, &mark, (long long)rows->width * count);
+        return true;
+    }
+
+    StreamStage* stage = &stream->stages[index];
+
+    if (stage->passthrough) {
+        stage->received += count;
+        return stream_push(stream, index + 1, rows, first, count);
+    }
+
+    if (stage->is_crop) {
+        return stream_push_crop(stream, index, rows, first, count);
+    }
+
+    if (stage->halo == 0) {
+        return stream_push_pointwise(stream, index, rows, first, count);
+    }
+
+    return stream_push_stencil(stream, index, rows, first, count);
+}
+
+bool pipeline_apply_stream(FilterPipeline* pipeline,
+                           const char* input_file,
+                           const char* output_file) {
+    if (!pipeline || !input_file || !output_file) {
+        fprintf(stderr, "Error: Cannot apply pipeline (NULL parameters)\n");
+        return false;
+    }
+
+    BMPMap map;
+    if (!bmp_map_open(&map, input_file)) {
+        return false;
+    }
+
+    // Начальная обрезка выполняется при чтении: декодируются только ее строки и столбцы
+    CropParams region;
+    pipeline_take_input_region(pipeline, map.width, map.height, &region);
+
+    Stream stream;
+    memset(&stream, 0, sizeof(Stream));
+    stream.count = pipeline->count;
+    stream.stages = (StreamStage*)calloc(pipeline->count > 0 ? pipeline->count : 1,
+                                         sizeof(StreamStage));
+    if (!stream.stages) {
+        fprintf(stderr, "Error: Memory allocation failed for streaming stages\n");
+        bmp_map_close(&map);
+        return false;
+    }
+
+    int total_halo = 0;
+    if (!stream_plan(&stream, pipeline, region.width, region.height, &total_halo)) {
+        free(stream.stages);
+        bmp_map_close(&map);
+        return false;
+    }
+
+    int out_width = stream.count > 0 ? stream.stages[stream.count - 1].out_width : region.width;
+    int out_height = stream.count > 0 ? stream.stages[stream.count - 1].out_height : region.height;
+
+    // Полоса не меньше суммарного ореола, чтобы повторные вычисления на краях были малы
+    int band_rows = STREAM_BAND_ROWS > 2 * total_halo ? STREAM_BAND_ROWS : 2 * total_halo;
+    if (band_rows > region.height) band_rows = region.height;
+
+    // Вход стадии не превышает полосу плюс накопленный ореол предыдущих стадий,
+    // окно дополнительно хранит ореол над и под готовыми строками
+    stream.window_rows = band_rows + 4 * total_halo;
+
+    printf("\nStreaming %d filter(s) over %dx%d image in bands of %d rows:\n",
+           pipeline->count, region.width, region.height, band_rows);
+    printf("========================================\n");
+
+    // Этапы отчета -profile в порядке прохождения строк
+    stream.profile_decode = profile_stage("decode");
+
+    int index = 0;
+    for (const FilterNode* node = pipeline->head; node; node = node->next, index++) {
+        printf("Filter %d/%d: %s (halo %d rows)\n", index + 1, pipeline->count,
+               node->name, stream.stages[index].halo);
+        stream.stages[index].profile = profile_stage(node->name);
+    }
+
+    stream.profile_encode = profile_stage("encode");
+
+    // Результат - маска, если ее строит последний фильтр
+    const StreamStage* last = stream.count > 0 ? &stream.stages[stream.count - 1] : NULL;
+    bool mask = last && !last->passthrough && last->node->descriptor &&
+                (last->node->descriptor->flags & FILTER_MASK);
+
+    bool success = bmp_writer_open(&stream.writer, output_file, out_width, out_height, mask);
+
+    ImagePool* pool = image_pool_create();
+    ImagePool* previous_pool = image_pool_set_active(pool);
+    filters_set_verbose(false);
+
+    Image* input = success ? image_create_format(region.width, band_rows, PIXEL_FORMAT_U8) : NULL;
+    success = success && input;
+
+    for (int y = 0; success && y < region.height; y += band_rows) {
+        int rows = region.height - y < band_rows ? region.height - y : band_rows;
+        ProfileMark mark;
+        profile_begin(&mark);
+
+        success = bmp_map_read_region(&map, input, region.x, region.y + y, region.width, rows);
+        profile_record(stream.profile_decode, &mark, (long long)region.width * rows);
+        success = success && stream_push(&stream, 0, input, 0, rows);
+    }
+
+    if (success && stream.written != out_height) {
+        fprintf(stderr, "Error: Streaming wrote %d of %d rows\n", stream.written, out_height);
+        success = false;
+    }
+
+    image_destroy(input);
+    for (int i = 0; i < stream.count; i++) {
+        image_destroy(stream.stages[i].window);
+    }
+
+    filters_set_verbose(true);
+    image_pool_set_active(previous_pool);
+    image_pool_destroy(pool);
+
+    if (stream.writer.file && !bmp_writer_close(&stream.writer)) {
+        success = false;
+    }
+
+    free(stream.stages);
+    bmp_map_close(&map);
+
+    printf("========================================\n");
+    if (success) {
+        printf("Streamed %d rows, window %d rows per filter\n\n", out_height, stream.window_rows);
+    }
+
+    return success;
+}
@@ -0,0 +1,22 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "pipeline.h"
+
+// Минимальная высота полосы строк, читаемой из входного файла
+#define STREAM_BAND_ROWS 64
+
+// Потоковое выполнение пайплайна: строки входного BMP проходят через
+// цепочку фильтров полосами и записываются, как только становятся готовыми.
+// Каждый фильтр хранит только свою полосу и строки ореола (halo), поэтому
+// память O(ширина * (полоса + суммарный ореол)) и не зависит от высоты.
+bool pipeline_apply_stream(FilterPipeline* pipeline,
+                           const char* input_file,
+                           const char* output_file);
+
+// Все фильтры пайплайна можно выполнять полосами: ореол известен и точен
+// (нет фильтров, которым нужно все изображение, например -canny, BORDER_WRAP
+// и рекурсивного размытия)
+bool pipeline_can_stream(const FilterPipeline* pipeline);
+
+#endif // STREAM_H
@@ -0,0 +1,262 @@
+# Проверка режимов, которые по построению не должны менять результат:
+#   optimizer - -optimize exact (по умолчанию) против -optimize off, побайтно;
+#               для каждой цепочки также проверяется, перезаписывает ли ее
+#               оптимизатор (перенос обрезки, сокращение повторов) или нет
+#               (виньетка, BORDER_WRAP, рекурсивное размытие)
+#   stream    - -stream и -mmap против обработки в памяти, побайтно
+#   mask      - -edge и -threshold пишут 1-битный BMP, совпадающий с
+#               24-битным результатом того же фильтра; такой файл читается
+#               обратно (также через -mmap и -stream)
+#   kernels   - фильтры с постоянным ядром 3x3 совпадают с -conv тем же ядром
+# Использование: check_equivalence.py optimizer|stream|mask|kernels image_craft.exe
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+# Цепочки и ожидание перезаписи оптимизатором
+OPTIMIZER_CHAINS = [
+    ('-blur 1 -crop 30 20 10 10', True),
+    ('-blur 2 -crop 200 150 5 5', True),
+    ('-blur 2 -crop 10 10 380 5', True),
+    ('-sharp -med 5 -crop 40 30 20 15', True),
+    ('-med 9 -crop 40 30 20 15', True),
+    ('-boxblur 3 -blur 1.5 box -crop 40 30 20 15', True),
+    ('-conv 5x3:1,2,3,2,1,1,2,3,2,1,1,2,3,2,1 -crop 40 30 1 1', True),
+    ('-emboss -crop 40 30 20 15', True),
+    ('-border mirror -blur 2 -crop 30 20 5 5', True),
+    ('-border constant 0.5 -conv 3x3:1,2,1,2,4,2,1,2,1 -crop 30 20 5 5', True),
+    ('-border constant -sharp -crop 30 20 0 0', True),
+    ('-blur 6 -med 7 -neg -neg -crop 300 250 40 30', True),
+    ('-neg -gs -sepia -crop 40 30 20 15', True),
+    ('-gs -gs -neg -neg', True),
+    ('-crop 50 50 10 10 -crop 20 20 5 5', True),
+    ('-blur 1 -crop 50 50 10 10 -neg -crop 20 20 45 45', True),
+    ('-blur 1 -crop 500 500', True),
+    ('-vignette -crop 40 30 20 15', False),
+    ('-border wrap -blur 2 -crop 30 20 5 5', False),
+    ('-blur 12 -crop 100 100 150 100', False),
+    ('-edge 0.1 -crop 40 30 20 15', False),
+    ('-threshold 4 0.02 -crop 40 30 20 15', False),
+    ('-sepia -sepia', False),
+]
+
+# Цепочки с рекурсивным размытием, -canny и BORDER_WRAP обрабатываются
+# целиком, результат все равно должен совпадать
+STREAM_CHAINS = [
+    '-gs',
+    '-blur 2',
+    '-blur 6',
+    '-blur 20',
+    '-sharp -blur 12',
+    '-border mirror -blur 6',
+    '-border wrap -blur 2',
+    '-canny 0.05 0.15',
+    '-blur 1.5 box',
+    '-boxblur 4',
+    '-med 5 -sharp',
+    '-crop 200 150 7 9 -blur 1.5',
+    '-blur 1 -crop 100 100 20 150 -neg',
+    '-sepia -vignette 0.6',
+    '-border mirror -conv 3x3:1,2,1,2,4,2,1,2,1',
+    '-border constant 0.25 -sharp',
+    '-border mirror -emboss',
+    '-edge 0.1',
+    '-blur 1 -edge 0.05 -neg',
+    '-threshold 3 0.02',
+]
+
+MASK_CHAINS = ['-edge 0.1', '-med 3 -edge 0.05', '-threshold 4 0.02']
+
+# Фильтр и та же свертка через -conv
+KERNEL_CHAINS = [
+    ('-emboss', '-conv 3x3:-2,-1,0,-1,1,1,0,1,2'),
+    ('-border constant 0.5 -emboss', '-border constant 0.5 -conv 3x3:-2,-1,0,-1,1,1,0,1,2'),
+    ('-gs -emboss', '-gs -conv 3x3:-2,-1,0,-1,1,1,0,1,2'),
+    ('-sharp', '-conv 3x3:0,-1,0,-1,5,-1,0,-1,0'),
+]
+
+
+def make_image(path, width, height):
+    # Градиенты, клетки и псевдослучайный шум: есть и гладкие области, и границы
+    row_size = (width * 3 + 3) // 4 * 4
+    data = bytearray()
+    seed = 12345
+    for y in range(height):
+        row = bytearray()
+        for x in range(width):
+            seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF
+            noise = (seed >> 16) % 41 - 20
+            cell = 60 if (x // 24 + y // 16) % 2 else 0
+            r = x * 255 // width + noise
+            g = y * 255 // height + cell
+            b = (x + y) * 255 // (width + height) - noise
+            row += bytes(max(0, min(255, v)) for v in (b, g, r))
+        data += row + b'\0' * (row_size - width * 3)
+    header = b'BM' + struct.pack('<IHHI', 54 + len(data), 0, 0, 54)
+    header += struct.pack('<IiiHHIIiiII', 40, width, height, 1, 24, 0, len(data), 2835, 2835, 0, 0)
+    with open(path, 'wb') as f:
+        f.write(header + data)
+
+
+def run(exe, source, output, args):
+    result = subprocess.run([exe, source, output] + args.split(),
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    return result.returncode, result.stdout.decode('utf-8', 'replace')
+
+
+def read_bytes(path):
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+# Пиксели BMP (24- или 1-битного) как список строк сверху вниз
+def read_pixels(path):
+    data = read_bytes(path)
+    offset = struct.unpack_from('<I', data, 10)[0]
+    width, height = struct.unpack_from('<ii', data, 18)
+    bits = struct.unpack_from('<H', data, 28)[0]
+    row_size = (width * bits + 31) // 32 * 4
+    rows = []
+    for y in range(abs(height)):
+        file_row = abs(height) - 1 - y if height > 0 else y
+        row = data[offset + file_row * row_size:offset + (file_row + 1) * row_size]
+        if bits == 1:
+            palette = data[54:62]
+            indices = [(row[x // 8] >> (7 - x % 8)) & 1 for x in range(width)]
+            rows.append([tuple(palette[4 * i:4 * i + 3]) for i in indices])
+        else:
+            rows.append([tuple(row[3 * x:3 * x + 3]) for x in range(width)])
+    return width, abs(height), bits, rows
+
+
+def check_optimizer(exe, source, work):
+    failed = 0
+    for args, rewritten in OPTIMIZER_CHAINS:
+        exact_file = os.path.join(work, 'exact.bmp')
+        off_file = os.path.join(work, 'off.bmp')
+        code_exact, output = run(exe, source, exact_file, args)
+        code_off, _ = run(exe, source, off_file, args + ' -optimize off')
+
+        problems = []
+        if code_exact != 0 or code_off != 0:
+            problems.append('код возврата %d/%d' % (code_exact, code_off))
+        elif read_bytes(exact_file) != read_bytes(off_file):
+            problems.append('результат отличается')
+        if ('Optimizer:' in output) != rewritten:
+            problems.append('ожидалась перезапись' if rewritten else 'неожиданная перезапись')
+
+        failed += report(args, problems)
+    return failed
+
+
+def check_stream(exe, source, work):
+    failed = 0
+    for args in STREAM_CHAINS:
+        files = [os.path.join(work, name + '.bmp') for name in ('memory', 'stream', 'mmap')]
+        codes = [run(exe, source, files[0], args)[0],
+                 run(exe, source, files[1], args + ' -stream')[0],
+                 run(exe, source, files[2], args + ' -mmap')[0]]
+
+        problems = []
+        if any(codes):
+            problems.append('коды возврата %s' % codes)
+        else:
+            reference = read_bytes(files[0])
+            if read_bytes(files[1]) != reference:
+                problems.append('-stream отличается')
+            if read_bytes(files[2]) != reference:
+                problems.append('-mmap отличается')
+
+        failed += report(args, problems)
+    return failed
+
+
+def check_mask(exe, source, work):
+    failed = 0
+    for args in MASK_CHAINS:
+        mask_file = os.path.join(work, 'mask.bmp')
+        reference_file = os.path.join(work, 'reference.bmp')
+        # Двойной негатив переводит маску в U8, не меняя пикселей (-optimize off не сокращает его)
+        codes = [run(exe, source, mask_file, args)[0],
+                 run(exe, source, reference_file, args + ' -neg -neg -optimize off')[0]]
+
+        problems = []
+        if any(codes):
+            problems.append('коды возврата %s' % codes)
+        else:
+            data = read_bytes(mask_file)
+            width, height, bits, rows = read_pixels(mask_file)
+            _, _, reference_bits, reference = read_pixels(reference_file)
+            row_size = (width + 31) // 32 * 4
+
+            if bits != 1 or reference_bits != 24:
+                problems.append('бит на пиксель %d/%d' % (bits, reference_bits))
+            elif data[54:62] != b'\0\0\0\0\xff\xff\xff\0':
+                problems.append('палитра не черно-белая')
+            elif len(data) != 62 + row_size * height:
+                problems.append('размер файла %d' % len(data))
+            elif rows != reference:
+                problems.append('пиксели отличаются от 24-битного результата')
+            else:
+                # Биты выравнивания за шириной изображения нулевые
+                for y in range(height):
+                    row = data[62 + y * row_size:62 + (y + 1) * row_size]
+                    if any((row[x // 8] >> (7 - x % 8)) & 1 for x in range(width, row_size * 8)):
+                        problems.append('ненулевые биты выравнивания')
+                        break
+
+            # Маска на входе декодируется цветами палитры
+            reference_data = read_bytes(reference_file)
+            for mode in ('', ' -mmap', ' -stream'):
+                read_back = os.path.join(work, 'read_back.bmp')
+                code, _ = run(exe, mask_file, read_back, '-neg -neg -optimize off' + mode)
+                if code != 0 or read_bytes(read_back) != reference_data:
+                    problems.append('маска не читается обратно' + mode)
+
+        failed += report(args, problems)
+    return failed
+
+
+def check_kernels(exe, source, work):
+    failed = 0
+    for args, conv in KERNEL_CHAINS:
+        files = [os.path.join(work, name + '.bmp') for name in ('filter', 'conv')]
+        codes = [run(exe, source, files[0], args)[0], run(exe, source, files[1], conv)[0]]
+
+        problems = []
+        if any(codes):
+            problems.append('коды возврата %s' % codes)
+        elif read_bytes(files[0]) != read_bytes(files[1]):
+            problems.append('отличается от %s' % conv)
+
+        failed += report(args, problems)
+    return failed
+
+
+def report(args, problems):
+    print('  %s %s%s' % ('FAIL' if problems else 'ok  ', args,
+                         ': ' + ', '.join(problems) if problems else ''))
+    return 1 if problems else 0
+
+
+def main():
+    checks = {'optimizer': check_optimizer, 'stream': check_stream, 'mask': check_mask,
+              'kernels': check_kernels}
+    if len(sys.argv) != 3 or sys.argv[1] not in checks:
+        print('Использование: check_equivalence.py optimizer|stream|mask|kernels image_craft.exe')
+        return 2
+
+    with tempfile.TemporaryDirectory() as work:
+        # Больше плитки (256) и полосы потокового режима (64 строки), ширина не кратна 8
+        source = os.path.join(work, 'texture.bmp')
+        make_image(source, 389, 301)
+        failed = checks[sys.argv[1]](os.path.abspath(sys.argv[2]), source, work)
+
+    print('Несовпадений: %d' % failed)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,73 @@
+# Проверка -threshold: маска сравнивается с порогом по средним окон,
+# посчитанным прямым суммированием, а не таблицей сумм.
+# Использование: check_threshold.py вход.bmp маска.bmp радиус [смещение]
+import struct
+import sys
+
+
+def read_bmp(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    offset = struct.unpack_from('<I', data, 10)[0]
+    width, height = struct.unpack_from('<ii', data, 18)
+    bits = struct.unpack_from('<H', data, 28)[0]
+    row_size = (width * bits + 31) // 32 * 4
+    rows = []
+    for y in range(abs(height)):
+        # Положительная высота - строки снизу вверх
+        file_row = abs(height) - 1 - y if height > 0 else y
+        start = offset + file_row * row_size
+        rows.append(data[start:start + row_size])
+    return width, abs(height), bits, rows
+
+
+def main():
+    source, mask, radius = sys.argv[1], sys.argv[2], int(sys.argv[3])
+    # Смещение хранится во float, как в ThresholdParams
+    offset = struct.unpack('f', struct.pack('f', float(sys.argv[4]) if len(sys.argv) > 4 else 0.0))[0]
+
+    width, height, bits, rows = read_bmp(source)
+    if bits != 24:
+        print('Ожидается 24-битный вход')
+        return 1
+    pixels = [[(row[x * 3 + 2], row[x * 3 + 1], row[x * 3]) for x in range(width)] for row in rows]
+
+    mask_width, mask_height, mask_bits, mask_rows = read_bmp(mask)
+    if (mask_width, mask_height, mask_bits) != (width, height, 1):
+        print('Маска должна быть 1-битной %dx%d' % (width, height))
+        return 1
+
+    # Те же операции в double, что у threshold_luminance: среднее суммы,
+    # умноженное на 1/255, и веса grayscale
+    scale = 1.0 / 255
+
+    def luminance(sums, count):
+        means = [s / count * scale for s in sums]
+        return 0.299 * means[0] + 0.587 * means[1] + 0.114 * means[2]
+
+    errors = 0
+    for y in range(height):
+        for x in range(width):
+            sums = [0, 0, 0]
+            count = 0
+            for v in range(max(0, y - radius), min(height, y + radius + 1)):
+                for u in range(max(0, x - radius), min(width, x + radius + 1)):
+                    for c in range(3):
+                        sums[c] += pixels[v][u][c]
+                    count += 1
+
+            expected = luminance(pixels[y][x], 1) > luminance(sums, count) - offset
+            actual = (mask_rows[y][x // 8] >> (7 - x % 8)) & 1 == 1
+            if expected != actual:
+                errors += 1
+
+    if errors:
+        print('Несовпадений с прямым подсчетом: %d' % errors)
+        return 1
+
+    print('Маска совпадает с прямым подсчетом')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -122,6 +122,58 @@ if %errorlevel% equ 0 (
     echo ❌ Ошибка
 )
 
+REM Тест 7: Адаптивный порог по таблице сумм против прямого подсчета средних
+echo.
+echo [Тест 7] Адаптивный порог
+image_craft.exe tests\test_images\test.bmp tests\output_threshold.bmp -threshold 4 0.05 > nul
+if %errorlevel% equ 0 python tests\test_scripts\check_threshold.py tests\test_images\test.bmp tests\output_threshold.bmp 4 0.05
+if %errorlevel% equ 0 (
+    echo ✅ Успешно
+) else (
+    echo ❌ Ошибка
+)
+
+REM Тест 8: Оптимизатор не меняет результат
+echo.
+echo [Тест 8] Оптимизатор не меняет результат
+python tests\test_scripts\check_equivalence.py optimizer image_craft.exe
+if %errorlevel% equ 0 (
+    echo ✅ Успешно
+) else (
+    echo ❌ Ошибка
+)
+
+REM Тест 9: -stream и -mmap совпадают с обработкой в памяти
+echo.
+echo [Тест 9] -stream и -mmap совпадают с обработкой в памяти
+python tests\test_scripts\check_equivalence.py stream image_craft.exe
+if %errorlevel% equ 0 (
+    echo ✅ Успешно
+) else (
+    echo ❌ Ошибка
+)
+
+REM Тест 10: 1-битная маска -edge и -threshold
+echo.
+echo [Тест 10] 1-битная маска -edge и -threshold
+python tests\test_scripts\check_equivalence.py mask image_craft.exe
+if %errorlevel% equ 0 (
+    echo ✅ Успешно
+) else (
+    echo ❌ Ошибка
+)
+
+REM Тест 11: Тиснение совпадает со сверткой тем же ядром
+echo.
+echo [Тест 11] Тиснение
+image_craft.exe tests\test_images\test.bmp tests\output_emboss.bmp -emboss > nul
+if %errorlevel% equ 0 python tests\test_scripts\check_equivalence.py kernels image_craft.exe
+if %errorlevel% equ 0 (
+    echo ✅ Успешно
+) else (
+    echo ❌ Ошибка
+)
+
 echo.
 echo ========================================
 echo Тестирование завершено!